@@ -0,0 +1,111 @@
+//*****************************************************************************
+// File Name	: adaptive.c
+// Title		: Per sensor rate adaptive sampling
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdlib.h>				// include abs
+#include "adaptive.h"
+
+//----- Functions --------------------------------------------------------------
+
+void adaptiveInit(adaptive_T* s, unsigned long now)
+{
+	s->due = now;
+	s->time = now;
+	s->last = 0;
+	s->min = 0;
+	s->max = 0;
+	s->slope = 0;
+	s->quantum = 1;
+	s->interval = ADAPTIVE_MIN_INTERVAL;
+	s->valid = 0;
+}
+
+unsigned char adaptiveDue(adaptive_T* s, unsigned long now)
+{
+	return (long)(now - s->due) >= 0;
+}
+
+unsigned char adaptiveHighRes(adaptive_T* s)
+{
+	return s->interval > ADAPTIVE_MIN_INTERVAL;
+}
+
+void adaptiveSample(adaptive_T* s, short value, unsigned char quantum, unsigned long now)
+{
+	short step = 0;
+	long rate = 0;
+	unsigned long dt;
+	unsigned char bound;
+
+	if (s->valid)
+	{
+		// a low resolution reading flickers between neighbouring steps, so
+		// the step is taken from the reading of the last counted one and a
+		// slow drift adds up until it is more than a quantum
+		step = value - s->last;
+		bound = (quantum > s->quantum) ? quantum : s->quantum;
+		dt = now - s->time;
+		if (dt == 0)
+			dt = 1;
+
+		if (abs(step) > bound)
+		{
+			// slope of this step in 1/16 degrees per minute, clamped to a short
+			rate = (long)step * 60 / (long)dt;
+			if (rate > 0x7FFF)
+				rate = 0x7FFF;
+			if (rate < -0x7FFF)
+				rate = -0x7FFF;
+
+			s->last = value;
+			s->quantum = quantum;
+			s->time = now;
+		}
+		else
+		{
+			step = 0;
+		}
+
+		if (value < s->min)
+			s->min = value;
+		if (value > s->max)
+			s->max = value;
+
+		// no decision until a change of up to a quantum since the last step
+		// would be slower than ADAPTIVE_FAST_SLOPE, keep polling as before
+		if (!step && dt * ADAPTIVE_FAST_SLOPE < (unsigned long)bound * 60)
+		{
+			s->due = now + s->interval;
+			return;
+		}
+		s->slope += ((short)rate - s->slope) / ADAPTIVE_EWMA;
+	}
+	else
+	{
+		s->min = value;
+		s->max = value;
+		s->last = value;
+		s->quantum = quantum;
+		s->time = now;
+		s->valid = 1;
+	}
+
+	// poll fast while changing, back off by doubling once stable
+	if ((abs(s->slope) >= ADAPTIVE_FAST_SLOPE) || (abs(step) >= ADAPTIVE_FAST_STEP))
+		s->interval = ADAPTIVE_MIN_INTERVAL;
+	else if (s->interval < ADAPTIVE_MAX_INTERVAL)
+		s->interval = (s->interval * 2 < ADAPTIVE_MAX_INTERVAL) ? s->interval * 2 : ADAPTIVE_MAX_INTERVAL;
+
+	s->due = now + s->interval;
+}
+
+void adaptiveError(adaptive_T* s, unsigned long now)
+{
+	s->interval = ADAPTIVE_MIN_INTERVAL;
+	s->due = now + s->interval;
+}
@@ -0,0 +1,60 @@
+//*****************************************************************************
+// File Name	: adaptive.h
+// Title		: Per sensor rate adaptive sampling
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Each sensor keeps O(1) running statistics: min, max and an EWMA of its
+// slope. While the value changes it is polled every ADAPTIVE_MIN_INTERVAL
+// seconds at low resolution. Once stable the interval doubles on every
+// reading up to ADAPTIVE_MAX_INTERVAL, and readings use high resolution.
+// Changes within a quantum add up across readings, so a slow drift is seen.
+//*****************************************************************************
+
+#ifndef adaptive_h
+#define adaptive_h
+
+//----- Include Files ---------------------------------------------------------
+#include "adaptiveconf.h"
+
+//----- Typedefs --------------------------------------------------------------
+
+typedef struct adaptive_S
+{
+	unsigned long due;				// systimeSeconds() of the next poll
+	unsigned long time;				// systimeSeconds() of the last counted step
+	short last;						// reading of the last counted step in 1/16 degrees
+	short min;
+	short max;
+	short slope;					// EWMA of the slope in 1/16 degrees per minute
+	unsigned char quantum;			// resolution of that reading in 1/16 degrees
+	unsigned char interval;			// seconds between polls
+	unsigned char valid;			// last, min, max and time hold a reading
+} adaptive_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// adaptiveInit()
+//     resets the statistics, the sensor is due right away
+void adaptiveInit(adaptive_T* s, unsigned long now);
+
+// adaptiveDue()
+//     returns true if the sensor should be polled now
+unsigned char adaptiveDue(adaptive_T* s, unsigned long now);
+
+// adaptiveHighRes()
+//     returns true if the next reading should use high resolution
+unsigned char adaptiveHighRes(adaptive_T* s);
+
+// adaptiveSample()
+//     updates the statistics with a reading and schedules the next poll
+//     quantum is the resolution of the reading in 1/16 degrees, a change
+//     since the last counted step no larger than this or the quantum of
+//     that step counts as no change yet
+void adaptiveSample(adaptive_T* s, short value, unsigned char quantum, unsigned long now);
+
+// adaptiveError()
+//     schedules a quick retry after a failed reading
+void adaptiveError(adaptive_T* s, unsigned long now);
+
+#endif
@@ -0,0 +1,25 @@
+//*****************************************************************************
+// File Name	: adaptiveconf.h
+// Title		: Adaptive sampling configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef ADAPTIVECONF_H
+#define ADAPTIVECONF_H
+
+// Seconds between polls while a value changes, and the slowest rate once stable
+// Set both to the same value to poll at a fixed rate
+#define ADAPTIVE_MIN_INTERVAL		2
+#define ADAPTIVE_MAX_INTERVAL		64
+
+// A sensor counts as changing if its slope (1/16 degrees per minute) or the
+// step since its last counted one (1/16 degrees) reaches these
+#define ADAPTIVE_FAST_SLOPE			8
+#define ADAPTIVE_FAST_STEP			4
+
+// EWMA weight of a new slope sample is 1/ADAPTIVE_EWMA
+#define ADAPTIVE_EWMA				4
+
+#endif
@@ -112,12 +112,12 @@ void dallasWriteBit(unsigned char bit);
 
 // dallasReadByte()
 //     reads a byte from the 1-wire bus and returns this byte
-//     note: global interupts are disabled in this function
+//     note: global interupts are disabled during each bit timeslot (~70 us)
 unsigned char  dallasReadByte(void);
 
 // dallasWriteByte()
 //     writes the passed in byte to the 1-wire bus
-//     note: global interupts are disabled in this function.
+//     note: global interupts are disabled during each bit timeslot (~70 us)
 void dallasWriteByte(unsigned char byte);
 
 // dallasReadRAM()
@@ -15,8 +15,12 @@
 // #include "timer128.h"			// include timer function library
 #include "dallas.h"	
 #include <util/delay.h>			// include dallas support
+#include "pin.h"				// include compile time pins
+#include "profile.h"			// include section profiler
 
 //----- Global Variables -------------------------------------------------------
+PIN_DEFINE(dallasBus, DALLAS_BUS)
+
 static unsigned char last_discrep = 0;	// last discrepancy for FindDevices
 static unsigned char done_flag = 0;		// done flag for FindDevices
 
@@ -59,45 +63,48 @@ unsigned char dallasInit(dallas_rom_id_T devices[])
 unsigned char dallasReset(void)
 {
 	unsigned char presence = DALLAS_PRESENCE;
+	PROFILE_ENTER(PROFILE_DALLAS_RESET);
 
-	cli();
-	
 	// pull line low
     
     //sbi(port, bit) (port) |= (1 << (bit))
     //cbi(port, bit) (port) &= ~(1 << (bit))
-	DALLAS_DDR |= (1 << DALLAS_PIN);
-	DALLAS_PORT &= ~(1 << DALLAS_PIN);
+	dallasBusOutput();
+	dallasBusLow();
 	
     
 	// wait for presence
+	// the reset pulse has no upper limit, so interrupts may stretch it
 	_delay_us(480);
 	
+	cli();
+
 	// allow line to return high
-	DALLAS_DDR &= ~(1 << DALLAS_PIN);
-	DALLAS_PORT |= (1 << DALLAS_PIN);
+	dallasBusInput();
+	dallasBusHigh();
 	
 	// wait for presence
 	_delay_us(80);
 
 	// if device is not present, pin will be 1
-	if (DALLAS_PORTIN & 0x01<<DALLAS_PIN)
+	if (dallasBusRead())
 		presence = DALLAS_NO_PRESENCE;
 
+	sei();
+
 	// wait for end of timeslot
 	_delay_us(400);
 
-	sei();
-
 	// now that we have reset, let's check bus health
 	// it should be noted that a delay may be needed here for devices that
 	// send out an alarming presence pulse signal after a reset
-	DALLAS_DDR &= ~(1 << DALLAS_PIN);
-	DALLAS_PORT |= (1 << DALLAS_PIN);
+	dallasBusInput();
+	dallasBusHigh();
 	//_delay_us(200);
-	if (!(DALLAS_PORTIN & (0x01<<DALLAS_PIN)))	// it should be pulled up to high
-		return DALLAS_BUS_ERROR;
+	if (!dallasBusRead())	// it should be pulled up to high
+		presence = DALLAS_BUS_ERROR;
 
+	PROFILE_EXIT(PROFILE_DALLAS_RESET);
 	return presence;
 }
 
@@ -106,21 +113,21 @@ unsigned char dallasReadBit(void)
 	unsigned char bit = 0;
 	
 	// pull line low to start timeslot
-	DALLAS_DDR |= (1 << DALLAS_PIN);
-	DALLAS_PORT &= ~(1 << DALLAS_PIN);
+	dallasBusOutput();
+	dallasBusLow();
 	
 	// delay appropriate time
 	_delay_us(6);
 
 	// release the bus
-	DALLAS_DDR &= ~(1 << DALLAS_PIN);
-	DALLAS_PORT |= (1 << DALLAS_PIN);
+	dallasBusInput();
+	dallasBusHigh();
 	
 	// delay appropriate time	
 	_delay_us(9);
 
 	// read the pin and set the variable to 1 if the pin is high
-	if (DALLAS_PORTIN & 0x01<<DALLAS_PIN)
+	if (dallasBusRead())
 		bit = 1;
 	
 	// finish read timeslot
@@ -132,8 +139,8 @@ unsigned char dallasReadBit(void)
 void dallasWriteBit(unsigned char bit)
 {
 	// drive bus low
-	DALLAS_DDR |= (1 << DALLAS_PIN);
-	DALLAS_PORT &= ~(1 << DALLAS_PIN);
+	dallasBusOutput();
+	dallasBusLow();
 	
 	// delay the proper time if we want to write a 0 or 1
 	if (bit)
@@ -142,8 +149,8 @@ void dallasWriteBit(unsigned char bit)
 		_delay_us(60);
 
 	// release bus
-	DALLAS_DDR &= ~(1 << DALLAS_PIN);
-	DALLAS_PORT |= (1 << DALLAS_PIN);
+	dallasBusInput();
+	dallasBusHigh();
 
 	// delay the proper time if we want to write a 0 or 1
 	if (bit)
@@ -156,40 +163,43 @@ unsigned char dallasReadByte(void)
 {
 	unsigned char i;
 	unsigned char byte = 0;
+	PROFILE_ENTER(PROFILE_DALLAS_READ_BYTE);
 
-	cli();
-	
 	// read all 8 bits
+	// interrupts are only held off for one timeslot at a time
 	for(i=0;i<8;i++)
 	{
+		cli();
 		if (dallasReadBit())
 			byte |= 0x01<<i;
+		sei();
 
 		// allow a us delay between each read
 		_delay_us(1);
 	}
 
-	sei();
-
+	PROFILE_EXIT(PROFILE_DALLAS_READ_BYTE);
 	return byte;
 }
 
 void dallasWriteByte(unsigned char byte)
 {
 	unsigned char i;
-
-	cli();
+	PROFILE_ENTER(PROFILE_DALLAS_WRITE_BYTE);
 
 	// write all 8 bits
+	// interrupts are only held off for one timeslot at a time
 	for(i=0;i<8;i++)
 	{
+		cli();
 		dallasWriteBit((byte>>i) & 0x01);
+		sei();
 		
 		// allow a us delay between each write
 		_delay_us(1);
 	}
 	
-	sei();
+	PROFILE_EXIT(PROFILE_DALLAS_WRITE_BYTE);
 }
 
 unsigned char dallasReadRAM(dallas_rom_id_T* rom_id, unsigned short addr, unsigned char len, unsigned char *data)
@@ -278,12 +288,20 @@ unsigned char dallasWriteRAM(dallas_rom_id_T* rom_id, unsigned short addr, unsig
 
 void dallasWaitUntilDone(void)
 {
+	unsigned char bit;
+	PROFILE_ENTER(PROFILE_DALLAS_WAIT);
+
 	//timerPause(6);
 	
 	// wait until we recieve a one
-	cli();
-	while(!dallasReadBit());
-	sei();
+	// interrupts are only held off for one read timeslot at a time
+	do
+	{
+		cli();
+		bit = dallasReadBit();
+		sei();
+	} while(!bit);
+	PROFILE_EXIT(PROFILE_DALLAS_WAIT);
 }
 
 unsigned char dallasReadROM(dallas_rom_id_T* rom_id)
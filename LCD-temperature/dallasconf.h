@@ -19,11 +19,9 @@
 #define DALLASCONF_H
 
 // Select which general-purpose I/O pin
-// will be used for driving the dallas bus
-#define DALLAS_PORT					PORTC		// the output port
-#define DALLAS_DDR					DDRC		// the DDR port
-#define DALLAS_PORTIN				PINC		// the input port
-#define DALLAS_PIN					1			// the pin number [0-7]
+// will be used for driving the dallas bus,
+// port letter and pin number [0-7] (pin.h)
+#define DALLAS_BUS					C, 1
 
 // Define the max number of Dallas devices which
 // can be automatically discovered on the bus
@@ -41,6 +41,13 @@ unsigned char readDeviceExt(unsigned char dev, unsigned short *result, char *reg
 	return ds18b20StartAndResultExt(&devices[dev - 1], result, reg1, reg2);
 }
 
+unsigned char readResultExt(unsigned char dev, unsigned short *result, char *reg1, char *reg2) {
+	if (dev == 0){
+		return DALLAS_DEVICE_ERROR;
+	}
+	return ds18b20ResultExt(&devices[dev - 1], result, reg1, reg2);
+}
+
 unsigned char ds18b20Setup(dallas_rom_id_T* rom_id, unsigned char resolution, char alarm_low, char alarm_high)
 {
 	unsigned char error;
@@ -111,6 +118,22 @@ unsigned char ds18b20Start(dallas_rom_id_T* rom_id)
 	return DALLAS_NO_ERROR;
 }
 
+unsigned char ds18b20StartAll(void)
+{
+	unsigned char error;
+
+	// reset the bus, every node listens to the next command
+	error = dallasReset();
+	if (error != DALLAS_PRESENCE)
+		return error;
+	dallasWriteByte(DALLAS_SKIP_ROM);
+
+	// send convert command
+	dallasWriteByte(DS18B20_CONVERT_TEMP);
+
+	return DALLAS_NO_ERROR;
+}
+
 /*------ DallasTempGetResult ------*/
 unsigned char ds18b20Result(dallas_rom_id_T* rom_id, unsigned short *result)
 {
@@ -214,6 +237,22 @@ unsigned char ds18b20StartAndResultExt(dallas_rom_id_T* rom_id, unsigned short *
 	return ds18b20ResultExt(rom_id,result, reg1, reg2);	
 }
 
+short ds18b20Fixed(unsigned short result, char reg1, char reg2)
+{
+	// truncate the half degree bit and take 0.25 off,
+	// then add (count per C - count remain) / count per C
+	short fixed;
+
+	// plain result in 1/2 degrees
+	if (!reg2)
+		return (short)result * 8;
+
+	fixed = ((short)result >> 1) * 16 - 4;
+	fixed += ((reg2 - reg1) * 16) / reg2;
+
+	return fixed;
+}
+
 /* OLD VERSION
 
 void ds18b20Print(unsigned short result, unsigned char resolution)
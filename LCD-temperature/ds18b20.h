@@ -53,6 +53,7 @@ dallas_rom_id_T * ds18b20Devices(void);
 
 unsigned char readDevice(unsigned char dev, unsigned short *result);
 unsigned char readDeviceExt(unsigned char dev, unsigned short *result, char *reg1, char *reg2);
+unsigned char readResultExt(unsigned char dev, unsigned short *result, char *reg1, char *reg2);
 
 // ds18b20Setup
 //     Sets up the device
@@ -67,6 +68,11 @@ unsigned char ds18b20Setup(dallas_rom_id_T* rom_id, unsigned char resolution, ch
 //     Returns either the corresponding error or DALLAS_NO_ERROR
 unsigned char ds18b20Start(dallas_rom_id_T* rom_id);
 
+// ds18b20StartAll()
+//     Start the conversion on every device on the bus at once (skip ROM)
+//     Returns either the corresponding error or DALLAS_NO_ERROR
+unsigned char ds18b20StartAll(void);
+
 // ds18b20Result()
 //     Gets the result of the conversion and stores it in *result
 //     Returns either the corresponding error or DALLAS_NO_ERROR
@@ -81,4 +87,10 @@ unsigned char ds18b20ResultExt(dallas_rom_id_T* rom_id, unsigned short *result,
 unsigned char ds18b20StartAndResult(dallas_rom_id_T* rom_id, unsigned short *result);
 unsigned char ds18b20StartAndResultExt(dallas_rom_id_T* rom_id, unsigned short *result, char *reg1, char *reg2);
 
+// ds18b20Fixed()
+//     Converts an extended result (result, count remain, count per C)
+//     to a signed fixed point temperature in 1/16 degrees
+//     Pass reg2 = 0 for a plain 9 bit result
+short ds18b20Fixed(unsigned short result, char reg1, char reg2);
+
 #endif
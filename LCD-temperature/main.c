@@ -15,10 +15,18 @@
 #include <avr/interrupt.h>
 //#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <util/delay.h>
+#include <avr/sleep.h>
 
+#include <pin.h>
 #include <dallas.h>
 #include <ds18b20.h>
+#include <systime.h>
+#include <profile.h>
+#include <telemetry.h>
+#include <samplelog.h>
+#include <adaptive.h>
 
 
 #define LINE1 0
@@ -35,7 +43,7 @@ LCD PIN | ATMEGA PIN
 RS      |   D0
 RW      |   D1
 Enable  |   D2
-Data0   |   B2
+Data0   |   B2 (D3 with TELEMETRY_ENABLE, B2 is the SPI slave select)
 Data1   |   B1
 Data2   |   B0
 Data3   |   D7
@@ -50,55 +58,112 @@ Data7   |   B6
 #define INITMODE 0x38    // FOUR ROWS, 20 characters
 #define CMD_WRITE 0x00
 #define DATA_WRITE 0x01
+#define CMD_READ 0x02
 #define CLEAR_LCD 0x01
 
-#define ENABLE 0x04
-#define DATA0 0x04
-#define DATA1 0x02
-#define DATA2 0x01
-#define DATA3 0x80
-#define DATA4 0x40
-#define DATA5 0x20
-#define DATA6 0x80
-#define DATA7 0x40
+// LCD pins as in the table above, port letter and bit (pin.h)
+#define LCD_RS D, 0
+#define LCD_RW D, 1
+#define LCD_ENABLE D, 2
+#ifdef TELEMETRY_ENABLE
+#define LCD_DATA0 D, 3
+#else
+#define LCD_DATA0 B, 2
+#endif
+#define LCD_DATA1 B, 1
+#define LCD_DATA2 B, 0
+#define LCD_DATA3 D, 7
+#define LCD_DATA4 D, 6
+#define LCD_DATA5 D, 5
+#define LCD_DATA6 B, 7
+#define LCD_DATA7 B, 6
+
+PIN_DEFINE(lcdRs, LCD_RS)
+PIN_DEFINE(lcdRw, LCD_RW)
+PIN_DEFINE(lcdEnable, LCD_ENABLE)
+PIN_DEFINE(lcdData0, LCD_DATA0)
+PIN_DEFINE(lcdData1, LCD_DATA1)
+PIN_DEFINE(lcdData2, LCD_DATA2)
+PIN_DEFINE(lcdData3, LCD_DATA3)
+PIN_DEFINE(lcdData4, LCD_DATA4)
+PIN_DEFINE(lcdData5, LCD_DATA5)
+PIN_DEFINE(lcdData6, LCD_DATA6)
+PIN_DEFINE(lcdData7, LCD_DATA7)
 
 void set_lcd_pins(unsigned char control, unsigned char data){
-  PORTD = control;
-  PORTB = 0x00;
-  
-  if (data & 0x01) 
-    PORTB |= DATA0;
-  if (data & 0x02)
-    PORTB |= DATA1;
-  if (data & 0x04)
-    PORTB |= DATA2;
-  if (data & 0x08)
-    PORTD |= DATA3;
-  if (data & 0x10)
-    PORTD |= DATA4;
-  if (data & 0x20)
-    PORTD |= DATA5;
-  if (data & 0x40)
-    PORTB |= DATA6;
-  if (data & 0x80)
-    PORTB |= DATA7;
-  //Annoying mapping...ugh
-  
+  PROFILE_ENTER(PROFILE_LCD_PINS);
+  lcdEnableLow();
+  lcdRsWrite(control & DATA_WRITE);
+  lcdRwWrite(control & CMD_READ);
+
+  // one sbi or cbi per pin, wherever it is
+  lcdData0Write(data & 0x01);
+  lcdData1Write(data & 0x02);
+  lcdData2Write(data & 0x04);
+  lcdData3Write(data & 0x08);
+  lcdData4Write(data & 0x10);
+  lcdData5Write(data & 0x20);
+  lcdData6Write(data & 0x40);
+  lcdData7Write(data & 0x80);
+
   //Toggle enable to tell matrix to read
-  PORTD |= ENABLE;
+  lcdEnableHigh();
   _delay_us(40);
-  PORTD &= ~(ENABLE);
+  lcdEnableLow();
+  PROFILE_EXIT(PROFILE_LCD_PINS);
+}
+
+// Turn the data pins into outputs, or release them to the display
+static void lcd_data_output(unsigned char output){
+  if (output){
+    lcdData0Output(); lcdData1Output(); lcdData2Output(); lcdData3Output();
+    lcdData4Output(); lcdData5Output(); lcdData6Output(); lcdData7Output();
+  }else{
+    lcdData0Input(); lcdData1Input(); lcdData2Input(); lcdData3Input();
+    lcdData4Input(); lcdData5Input(); lcdData6Input(); lcdData7Input();
+  }
+}
+
+// Read the busy flag (Data7). All data pins are released while the display drives them.
+unsigned char lcd_busy(){
+  unsigned char busy;
+
+  lcd_data_output(0);
+  lcdData7High(); // pull-up, a missing display reads as busy
+  lcdRsLow();
+  lcdRwHigh();
+  lcdEnableHigh();
+  _delay_us(1);
+  busy = lcdData7Read();
+  lcdEnableLow();
+  lcd_data_output(1);
+  return busy;
+}
+
+// Poll the busy flag until the display is ready or timeout_ms has passed.
+// Returns 0 on timeout, in which case the full timeout has been waited out as before.
+unsigned char lcd_wait_ready(unsigned short timeout_ms){
+  unsigned short start = systimeMs();
+
+  while (lcd_busy()){
+    if ((unsigned short)(systimeMs() - start) > timeout_ms)
+      return 0;
+  }
+  return 1;
 }
 
+#define LCD_POWERUP_MS 100 // HD44780 internal reset takes 10 ms after Vcc is up
+#define LCD_CMD_MS 20
+
 void clear_lcd(){
     set_lcd_pins(CMD_WRITE, CLEAR_LCD);
+    lcd_wait_ready(LCD_CMD_MS);
 }
 
 void init_lcd(){
     clear_lcd();
-    _delay_ms(20);
     set_lcd_pins(CMD_WRITE, INITMODE);
-    _delay_ms(20);
+    lcd_wait_ready(LCD_CMD_MS);
     set_lcd_pins(CMD_WRITE, DISPLAYMODE);
 }
 
@@ -122,7 +187,161 @@ void clear_line(unsigned char line){
     write_buffer(empty_buffer, 20, line);
 }
 
+void draw_labels(){
+    clear_line(LINE1);
+    clear_line(LINE2);
+    clear_line(LINE3);
+    clear_line(LINE4);
+    write_buffer("Temperatures:", 13, LINE1);
+    write_buffer("Temp1 : ", 8, LINE2);
+    write_buffer("Temp2 : ", 8, LINE3);
+    write_buffer("Temp3 : ", 8, LINE4);
+}
+
+void show_temp(short fixed, unsigned char line){
+    char tempBuffer[8] = "       ";
+
+    dtostrf(fixed / 16.0, 3, 3, tempBuffer);
+    if ((fixed < 0) | (fixed >= 100 * 16)){
+      write_buffer(tempBuffer, 7, line + 8);
+    }else{
+      write_buffer(tempBuffer, 6, line + 8);
+    }
+}
+
+// Sensors in display order: device number, display line and calibration in 1/16 degrees
+#define SENSORS 3
+const unsigned char sensor_dev[SENSORS] = {3, 1, 2};
+const unsigned char sensor_line[SENSORS] = {LINE2, LINE3, LINE4};
+const char sensor_calibration[SENSORS] = {-3, 0, 0}; // 0.186 deg calibration on Temp1
+char spinner[4] = "-\\|/";
+adaptive_T sensor_rate[SENSORS];
+
+#ifdef SAMPLELOG_ENABLE
+short log_values[SENSORS];
+unsigned char log_valid = 0;
+#endif
+
+// Take a reading in 1/16 degrees, quantum is its resolution
+void sensor_reading(unsigned char sensor, short fixed, unsigned char quantum){
+    show_temp(fixed, sensor_line[sensor]);
+    adaptiveSample(&sensor_rate[sensor], fixed, quantum, systimeSeconds());
+#ifdef TELEMETRY_ENABLE
+    telemetrySample(sensor, &ds18b20Devices()[sensor_dev[sensor] - 1], fixed);
+#endif
+#ifdef SAMPLELOG_ENABLE
+    log_values[sensor] = fixed;
+    log_valid |= (1 << sensor);
+#endif
+}
+
+// Convert and read one sensor. On failure show the error code and search the bus again.
+void poll_sensor(unsigned char sensor){
+    unsigned short temp;
+    char test[2];
+    char reg1 = 0;
+    char reg2 = 0;
+    unsigned char error;
+
+    // low resolution skips the count registers: 2 scratchpad bytes instead of 8
+    if (adaptiveHighRes(&sensor_rate[sensor]))
+        error = readDeviceExt(sensor_dev[sensor], &temp, &reg1, &reg2);
+    else
+        error = readDevice(sensor_dev[sensor], &temp);
+
+    if (error == DALLAS_NO_ERROR){
+        sensor_reading(sensor, ds18b20Fixed(temp, reg1, reg2) + sensor_calibration[sensor], reg2 ? 1 : 8);
+    }else{
+        test[0] = (char)readDevice(sensor_dev[sensor], &temp);
+        write_buffer(s_buf, 5, sensor_line[sensor] + 7);
+        write_buffer(test, 1, sensor_line[sensor] + 12);
+#ifdef TELEMETRY_ENABLE
+        telemetryError(sensor, test[0]);
+#endif
+#ifdef SAMPLELOG_ENABLE
+        log_valid &= ~(1 << sensor);
+#endif
+        adaptiveError(&sensor_rate[sensor], systimeSeconds());
+        ds18b20Init();
+    }
+}
+
+#define BUS_TIMEOUT_MS 1000
+#define TICK_MS 250 // main loop period while no sensor is due
+
+// Boot phases, boot_time[] holds the time in ms since reset when each one finished
+#define BOOT_BUS 0      // 1-wire presence pulse seen
+#define BOOT_SEARCH 1   // devices found, first conversion started
+#define BOOT_LCD 2      // display initialised and labels written
+#define BOOT_CONVERT 3  // first conversion done
+#define BOOT_DATA 4     // first readings on the display
+#define BOOT_PHASES 5
+
+unsigned short boot_time[BOOT_PHASES];
+
+unsigned char wait_bus_ready(){
+    while (dallasReset() != DALLAS_PRESENCE){
+        if (systimeMs() > BUS_TIMEOUT_MS)
+            return 0;
+    }
+    return 1;
+}
+
+#ifdef PROFILE_ENABLE
+#define PROFILE_PAGE_MS 3000
+
+const char profile_tags[PROFILE_SECTIONS][4] = {"RST", "RDB", "WRB", "WAI", "LCD"};
 
+// Write "tag v0 v1 ..." on a display line, values that do not fit in 20 characters are left out
+void show_numbers(const char *tag, unsigned long values[], unsigned char n, unsigned char line){
+    char buf[20];
+    char num[11];
+    unsigned char len = strlen(tag);
+    unsigned char size;
+
+    memcpy(buf, empty_buffer, 20);
+    memcpy(buf, tag, len);
+    for (unsigned char i = 0; i < n; i++){
+        ultoa(values[i], num, 10);
+        size = strlen(num);
+        if (len + 1 + size > 20)
+            break;
+        memcpy(buf + len + 1, num, size);
+        len += 1 + size;
+    }
+    write_buffer(buf, 20, line);
+}
+
+// Debug pages: min, max and average of each profiled section in us, then the boot phases in ms
+void show_profile(){
+    const unsigned char lines[4] = {LINE1, LINE2, LINE3, LINE4};
+    profile_entry_T entry;
+    unsigned long values[BOOT_PHASES];
+    unsigned char row = 0;
+
+    for (unsigned char i = 0; i <= PROFILE_SECTIONS; i++){
+        if (i < PROFILE_SECTIONS){
+            profileRead(i, &entry);
+            values[0] = entry.count ? entry.min / CYCLES_PER_US : 0;
+            values[1] = entry.max / CYCLES_PER_US;
+            values[2] = entry.count ? entry.total / entry.count / CYCLES_PER_US : 0;
+            show_numbers(profile_tags[i], values, 3, lines[row]);
+        }else{
+            for (unsigned char j = 0; j < BOOT_PHASES; j++){
+                values[j] = boot_time[j];
+            }
+            show_numbers("Boot", values, BOOT_PHASES, lines[row]);
+        }
+        if (++row == 4 || i == PROFILE_SECTIONS){
+            while (row < 4){
+                clear_line(lines[row++]);
+            }
+            _delay_ms(PROFILE_PAGE_MS);
+            row = 0;
+        }
+    }
+}
+#endif
 
 int main()
 
@@ -132,88 +351,104 @@ int main()
   DDRB = 0xFF;
   DDRD = 0xFF;
   PORTC = 0xFC;
-  _delay_ms(1500);
+  systimeInit();
+#ifdef PROFILE_ENABLE
+  profileInit();
+#endif
+#ifdef TELEMETRY_ENABLE
+  telemetryInit();
+#endif
+#ifdef SAMPLELOG_ENABLE
+  samplelogInit();
+#endif
+  sei();
+
+  // Start the first conversion on every sensor, the display is set up while it runs
+  unsigned char converting = 0;
+  if (wait_bus_ready()){
+      boot_time[BOOT_BUS] = systimeMs();
+      ds18b20Init();
+      converting = (ds18b20StartAll() == DALLAS_NO_ERROR);
+  }
+  boot_time[BOOT_SEARCH] = systimeMs();
+
+  lcd_wait_ready(LCD_POWERUP_MS);
   init_lcd();
-  _delay_ms(250);
   clear_lcd();
-  _delay_ms(200);
-  clear_line(LINE2);
-  clear_line(LINE4);
-  
-  write_buffer("Temperatures:", 13, LINE1);
-  
-  
-  ds18b20Init();
-  _delay_ms(2500);
-  
-  clear_line(LINE2);
-  clear_line(LINE3);
-  clear_line(LINE4);
+  draw_labels();
   
   //INIT OK, TEMP MAGICK TIME
   unsigned short temp;
-  char test[2];
   char reg1;
   char reg2;
-  char tempBuffer[7] = "       ";
-  write_buffer("Temp1 : ", 8, LINE2);
-  write_buffer("Temp2 : ", 8, LINE3);
-  write_buffer("Temp3 : ", 8, LINE4);
+  unsigned long now = systimeSeconds();
+  unsigned short idle;
+  unsigned char spin = 0;
+#ifdef PROFILE_ENABLE
+  unsigned char rounds = 0;
+#endif
+#ifdef SAMPLELOG_ENABLE
+  unsigned long next_log;
+#endif
+  boot_time[BOOT_LCD] = systimeMs();
+
+  for (unsigned char i = 0; i < SENSORS; i++){
+      adaptiveInit(&sensor_rate[i], now);
+  }
+  if (converting){
+      dallasWaitUntilDone();
+      boot_time[BOOT_CONVERT] = systimeMs();
+      for (unsigned char i = 0; i < SENSORS; i++){
+          if (readResultExt(sensor_dev[i], &temp, &reg1, &reg2) == DALLAS_NO_ERROR)
+              sensor_reading(i, ds18b20Fixed(temp, reg1, reg2) + sensor_calibration[i], 1);
+      }
+#ifdef TELEMETRY_ENABLE
+      telemetryPublish();
+#endif
+  }
+  boot_time[BOOT_DATA] = systimeMs();
+#ifdef SAMPLELOG_ENABLE
+  next_log = systimeSeconds();
+#endif
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
   while(1){
-      write_buffer("-", 1, LINE1 + 18);
-      _delay_ms(25);
-      if (readDeviceExt(3, &temp, &reg1, &reg2) == DALLAS_NO_ERROR){
-          temp = temp >> 1;
-         
-          dtostrf(((double)temp - 0.25 - 0.1875 + ((reg2 - reg1) / (double)reg2)), 3, 3, tempBuffer); // 0.186 deg calibration
-          
-          if ((temp < 0) | (temp > 99)){
-            write_buffer(tempBuffer, 7, LINE2 + 8);  
-          }else{
-            write_buffer(tempBuffer, 6, LINE2 + 8);            
+      // poll only the sensors that are due, see adaptive.h
+      now = systimeSeconds();
+      for (unsigned char i = 0; i < SENSORS; i++){
+          if (adaptiveDue(&sensor_rate[i], now)){
+              write_buffer(&spinner[spin], 1, LINE1 + 18);
+              spin = (spin + 1) & 0x03;
+              poll_sensor(i);
           }
-          temp = 0;          
-      }else{
-          test[0] = (char)readDevice(3, &temp);
-          write_buffer(s_buf, 5, LINE2 + 7);
-          write_buffer(test, 1, LINE2 + 12);
-          ds18b20Init();
       }
-      write_buffer("\\", 1, LINE1 + 18);
-      _delay_ms(25);
-      if (readDeviceExt(1, &temp, &reg1, &reg2) == DALLAS_NO_ERROR){
-          temp = temp >> 1;
-          dtostrf(((double)temp - 0.25 + ((reg2 - reg1) / (double)reg2)), 3, 3, tempBuffer);
-          if ((temp < 0) | (temp > 99)){
-            write_buffer(tempBuffer, 7, LINE3 + 8);  
-          }else{
-            write_buffer(tempBuffer, 6, LINE3 + 8);            
-          }
-          temp = 0;          
-      }else{
-          test[0] = (char)readDevice(1, &temp);
-          write_buffer(s_buf, 5, LINE3 + 7);
-          write_buffer(test, 1, LINE3 + 12);
-          ds18b20Init();
+      now = systimeSeconds();
+#ifdef SAMPLELOG_ENABLE
+      // rows stay on a SAMPLELOG_PERIOD grid, if we fell behind the grid restarts
+      if (now >= next_log){
+          samplelogRow(next_log, log_values, log_valid);
+          next_log += SAMPLELOG_PERIOD;
+          if (next_log <= now)
+              next_log = now + SAMPLELOG_PERIOD;
       }
-	  write_buffer("|", 1, LINE1 + 18);
-      _delay_ms(25);
-      if (readDeviceExt(2, &temp, &reg1, &reg2) == DALLAS_NO_ERROR){
-          temp = temp >> 1;
-          dtostrf(((double)temp - 0.25 + ((reg2 - reg1) / (double)reg2)), 3, 3, tempBuffer);
-          if ((temp < 0) | (temp > 99)){
-            write_buffer(tempBuffer, 7, LINE4 + 8);  
-          }else{
-            write_buffer(tempBuffer, 6, LINE4 + 8);            
-          }
-          temp = 0;          
-      }else{
-          test[0] = (char)readDevice(2, &temp);
-          write_buffer(s_buf, 5, LINE4 + 7);
-          write_buffer(test, 1, LINE4 + 12);
-          ds18b20Init();
+#endif
+#ifdef TELEMETRY_ENABLE
+      telemetryPublish();
+#endif
+#if defined(TELEMETRY_ENABLE) && defined(SAMPLELOG_ENABLE)
+      telemetryLogService();
+#endif
+#ifdef PROFILE_ENABLE
+      if (++rounds == PROFILE_PAGE_EVERY){
+          rounds = 0;
+          show_profile();
+          draw_labels();
+      }
+#endif
+      // sleep until the next tick, Timer1 overflows wake us every 8 ms
+      idle = systimeMs();
+      while ((unsigned short)(systimeMs() - idle) < TICK_MS){
+          sleep_mode();
       }
-      write_buffer("/", 1, LINE1 + 18);
-      _delay_ms(370);
   }
 }
@@ -0,0 +1,26 @@
+//*****************************************************************************
+// File Name	: profileconf.h
+// Title		: Section cycle profiler configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef PROFILECONF_H
+#define PROFILECONF_H
+
+// Uncomment to build the profiler in, or pass -DPROFILE_ENABLE
+//#define PROFILE_ENABLE
+
+// Profiled sections, each one is a row in the profile table
+#define PROFILE_DALLAS_RESET		0			// dallasReset()
+#define PROFILE_DALLAS_READ_BYTE	1			// dallasReadByte()
+#define PROFILE_DALLAS_WRITE_BYTE	2			// dallasWriteByte()
+#define PROFILE_DALLAS_WAIT			3			// dallasWaitUntilDone()
+#define PROFILE_LCD_PINS			4			// set_lcd_pins()
+#define PROFILE_SECTIONS			5
+
+// Number of main loop rounds between profile pages on the display
+#define PROFILE_PAGE_EVERY			120
+
+#endif
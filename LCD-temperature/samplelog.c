@@ -0,0 +1,211 @@
+//*****************************************************************************
+// File Name	: samplelog.c
+// Title		: Delta compressed sample log
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/eeprom.h>			// include EEPROM support
+#include <string.h>				// include string support
+#include "samplelog.h"
+
+#ifdef SAMPLELOG_ENABLE
+
+//----- Global Variables -------------------------------------------------------
+static samplelog_block_T samplelog_ram[SAMPLELOG_BLOCKS];
+static unsigned char samplelog_tail = 0;			// oldest block in SRAM
+static unsigned char samplelog_count = 0;			// blocks in SRAM, the newest one is open
+static unsigned char samplelog_rows = 0;			// rows in the open block
+static short samplelog_last[SAMPLELOG_SENSORS];		// last reading of each sensor in the open block
+static unsigned short samplelog_seq = 0;			// sequence number of the next block
+static unsigned short samplelog_drained = 0;		// blocks before this one reached the host
+
+#if SAMPLELOG_EEPROM_BLOCKS
+static samplelog_block_T EEMEM samplelog_eeprom[SAMPLELOG_EEPROM_BLOCKS];
+static unsigned char samplelog_ee_next = 0;			// slot for the next spilled block
+static unsigned char samplelog_ee_count = 0;		// consecutive blocks ending at samplelog_ee_newest
+static unsigned short samplelog_ee_newest = 0;
+#endif
+
+//----- Functions --------------------------------------------------------------
+
+#if SAMPLELOG_EEPROM_BLOCKS
+static void samplelogSpill(samplelog_block_T* block)
+{
+	// a gap in the numbering means the host has drained everything older
+	if (block->seq != (unsigned short)(samplelog_ee_newest + 1))
+		samplelog_ee_count = 0;
+
+	eeprom_update_block(block, &samplelog_eeprom[samplelog_ee_next], sizeof(samplelog_block_T));
+
+	samplelog_ee_newest = block->seq;
+	samplelog_ee_next = (samplelog_ee_next + 1) % SAMPLELOG_EEPROM_BLOCKS;
+	if (samplelog_ee_count < SAMPLELOG_EEPROM_BLOCKS)
+		samplelog_ee_count++;
+}
+#endif
+
+static samplelog_block_T* samplelogNewBlock(unsigned long time)
+{
+	samplelog_block_T* block;
+
+	if (samplelog_count == SAMPLELOG_BLOCKS)
+	{
+		// drop the oldest block
+#if SAMPLELOG_EEPROM_BLOCKS
+		if ((short)(samplelog_ram[samplelog_tail].seq - samplelog_drained) >= 0)
+			samplelogSpill(&samplelog_ram[samplelog_tail]);
+#endif
+		samplelog_tail = (samplelog_tail + 1) % SAMPLELOG_BLOCKS;
+		samplelog_count--;
+	}
+
+	block = &samplelog_ram[(samplelog_tail + samplelog_count) % SAMPLELOG_BLOCKS];
+	samplelog_count++;
+
+	block->seq = samplelog_seq++;
+	block->time = time;
+	block->len = 0;
+	samplelog_rows = 0;
+	memset(samplelog_last, 0, sizeof(samplelog_last));
+
+	return block;
+}
+
+static unsigned char samplelogEncodeRow(unsigned char* out, short values[], unsigned char valid)
+{
+	unsigned char i;
+	unsigned char len = 0;
+	unsigned short code;
+	short delta;
+
+	for(i=0;i<SAMPLELOG_SENSORS;i++)
+	{
+		code = 0;
+		if (valid & (1 << i))
+		{
+			// zigzag, then shift up by one to keep 0 for a missing reading
+			delta = values[i] - samplelog_last[i];
+			code = (((unsigned short)delta << 1) ^ (unsigned short)(delta >> 15)) + 1;
+			samplelog_last[i] = values[i];
+		}
+
+		while (code > 0x7F)
+		{
+			out[len++] = (code & 0x7F) | 0x80;
+			code >>= 7;
+		}
+		out[len++] = code;
+	}
+
+	return len;
+}
+
+void samplelogInit(void)
+{
+#if SAMPLELOG_EEPROM_BLOCKS
+	samplelog_block_T header;
+	unsigned char i;
+	unsigned char slot = 0;
+	unsigned char found = 0;
+
+	// find the newest block, erased slots read as len 0xFF
+	for(i=0;i<SAMPLELOG_EEPROM_BLOCKS;i++)
+	{
+		eeprom_read_block(&header, &samplelog_eeprom[i], SAMPLELOG_HEADER);
+		if (header.len > SAMPLELOG_DATA)
+			continue;
+		if (!found || (short)(header.seq - samplelog_ee_newest) > 0)
+		{
+			samplelog_ee_newest = header.seq;
+			slot = i;
+			found = 1;
+		}
+	}
+
+	if (found)
+	{
+		// count the consecutive blocks before it
+		samplelog_ee_count = 1;
+		for(i=1;i<SAMPLELOG_EEPROM_BLOCKS;i++)
+		{
+			eeprom_read_block(&header, &samplelog_eeprom[(slot + SAMPLELOG_EEPROM_BLOCKS - i) % SAMPLELOG_EEPROM_BLOCKS], SAMPLELOG_HEADER);
+			if ((header.len > SAMPLELOG_DATA) || (header.seq != (unsigned short)(samplelog_ee_newest - i)))
+				break;
+			samplelog_ee_count++;
+		}
+		samplelog_ee_next = (slot + 1) % SAMPLELOG_EEPROM_BLOCKS;
+		samplelog_seq = samplelog_ee_newest + 1;
+	}
+#endif
+	samplelog_drained = samplelog_seq;
+}
+
+void samplelogRow(unsigned long time, short values[], unsigned char valid)
+{
+	unsigned char row[SAMPLELOG_SENSORS * 3];
+	unsigned char len = 0;
+	unsigned char fits = 0;
+	samplelog_block_T* block = 0;
+
+	if (samplelog_count)
+	{
+		block = &samplelog_ram[(samplelog_tail + samplelog_count - 1) % SAMPLELOG_BLOCKS];
+		if (time == block->time + (unsigned long)samplelog_rows * SAMPLELOG_PERIOD)
+		{
+			len = samplelogEncodeRow(row, values, valid);
+			fits = (block->len + len <= SAMPLELOG_DATA);
+		}
+	}
+
+	if (!fits)
+	{
+		block = samplelogNewBlock(time);
+		len = samplelogEncodeRow(row, values, valid);
+	}
+
+	memcpy(&block->data[block->len], row, len);
+	block->len += len;
+	samplelog_rows++;
+}
+
+unsigned char samplelogRead(unsigned short seq, samplelog_block_T* block)
+{
+	short offset;
+
+#if SAMPLELOG_EEPROM_BLOCKS
+	if (samplelog_ee_count)
+	{
+		offset = samplelog_ee_newest - seq;
+		if (offset >= samplelog_ee_count)
+			offset = samplelog_ee_count - 1;	// dropped, start at the oldest kept
+		if (offset >= 0)
+		{
+			eeprom_read_block(block, &samplelog_eeprom[(samplelog_ee_next + SAMPLELOG_EEPROM_BLOCKS - 1 - offset) % SAMPLELOG_EEPROM_BLOCKS], sizeof(samplelog_block_T));
+			return SAMPLELOG_CLOSED;
+		}
+	}
+#endif
+
+	if (samplelog_count == 0)
+		return SAMPLELOG_NONE;
+
+	offset = seq - samplelog_ram[samplelog_tail].seq;
+	if (offset < 0)
+		offset = 0;								// dropped, start at the oldest kept
+	if (offset >= samplelog_count)
+		offset = samplelog_count - 1;
+
+	*block = samplelog_ram[(samplelog_tail + offset) % SAMPLELOG_BLOCKS];
+	return (offset == samplelog_count - 1) ? SAMPLELOG_OPEN : SAMPLELOG_CLOSED;
+}
+
+void samplelogDrained(unsigned short seq)
+{
+	samplelog_drained = seq;
+}
+
+#endif
@@ -0,0 +1,78 @@
+//*****************************************************************************
+// File Name	: samplelog.h
+// Title		: Delta compressed sample log
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Readings are stored as rows, one value per sensor every SAMPLELOG_PERIOD
+// seconds, in fixed size blocks. Each block decodes on its own:
+//
+//   seq   (2 bytes) block sequence number, consecutive, kept across resets
+//   time  (4 bytes) systimeSeconds() of the first row
+//   len   (1 byte)  bytes used in data
+//   data            rows, SAMPLELOG_SENSORS codes per row
+//
+// A code is a varint (7 bits per byte, low bits first, bit 7 set on all but
+// the last byte) of zigzag(delta) + 1, where delta is the change in 1/16
+// degrees since the last reading of that sensor in the same block (from 0
+// for the first one). zigzag maps 0,-1,1,-2,2... to 0,1,2,3,4... Code 0
+// marks a missing reading. A stable sensor costs one byte per row.
+//
+// Row n of a block was taken at time + n * SAMPLELOG_PERIOD. Blocks roll over
+// oldest first. When SAMPLELOG_EEPROM_BLOCKS is set, blocks that fall out of
+// SRAM before the host has drained them are spilled to EEPROM.
+//*****************************************************************************
+
+#ifndef samplelog_h
+#define samplelog_h
+
+//----- Include Files ---------------------------------------------------------
+#include "samplelogconf.h"
+
+#ifdef SAMPLELOG_ENABLE
+
+//----- Defines ---------------------------------------------------------------
+#define SAMPLELOG_HEADER			7
+#define SAMPLELOG_DATA				(SAMPLELOG_BLOCK_SIZE - SAMPLELOG_HEADER)
+
+// samplelogRead() results
+#define SAMPLELOG_NONE				0			// nothing logged yet
+#define SAMPLELOG_CLOSED			1			// block is complete
+#define SAMPLELOG_OPEN				2			// block is still being written
+
+//----- Typedefs --------------------------------------------------------------
+
+typedef struct samplelog_block_S
+{
+	unsigned short seq;
+	unsigned long time;
+	unsigned char len;
+	unsigned char data[SAMPLELOG_DATA];
+} samplelog_block_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// samplelogInit()
+//     finds the newest spilled block in EEPROM, so numbering continues
+void samplelogInit(void);
+
+// samplelogRow()
+//     appends a row taken at the given time
+//     bit i of valid is set if values[i] holds a reading
+//     a row that is not one period after the previous one starts a new block
+void samplelogRow(unsigned long time, short values[], unsigned char valid);
+
+// samplelogRead()
+//     copies the block with the given sequence number, or the oldest kept
+//     block if that one has been dropped. Check block->seq for which it was
+//     returns SAMPLELOG_NONE, SAMPLELOG_CLOSED or SAMPLELOG_OPEN
+unsigned char samplelogRead(unsigned short seq, samplelog_block_T* block);
+
+// samplelogDrained()
+//     tells the log that blocks before seq have reached the host,
+//     so they do not need to be spilled to EEPROM
+void samplelogDrained(unsigned short seq);
+
+#endif
+
+#endif
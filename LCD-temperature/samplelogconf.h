@@ -0,0 +1,33 @@
+//*****************************************************************************
+// File Name	: samplelogconf.h
+// Title		: Sample log configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef SAMPLELOGCONF_H
+#define SAMPLELOGCONF_H
+
+// Uncomment to keep a history of readings, or pass -DSAMPLELOG_ENABLE
+// The log is drained over SPI, so TELEMETRY_ENABLE is needed to read it out
+//#define SAMPLELOG_ENABLE
+
+// Number of sensors in each row
+#define SAMPLELOG_SENSORS			3
+
+// Seconds between rows
+#define SAMPLELOG_PERIOD			60
+
+// Block size in bytes, header included
+#define SAMPLELOG_BLOCK_SIZE		64
+
+// Blocks kept in SRAM
+#define SAMPLELOG_BLOCKS			3
+
+// Blocks kept in EEPROM for data that falls out of SRAM before it is drained
+// 0 disables the spill. Each spilled block blocks the caller for about
+// 3.4 ms per byte while the EEPROM is written
+#define SAMPLELOG_EEPROM_BLOCKS		7
+
+#endif
@@ -0,0 +1,194 @@
+//*****************************************************************************
+// File Name	: telemetry.c
+// Title		: SPI slave telemetry endpoint
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include <string.h>				// include string support
+#include "pin.h"
+#include "systime.h"
+#include "telemetry.h"
+
+#ifdef TELEMETRY_ENABLE
+
+//----- Defines ---------------------------------------------------------------
+#define TELEMETRY_SS				B, 2		// slave select
+#define TELEMETRY_MISO				B, 4
+#define TELEMETRY_NONE				0xFF		// no buffer latched by the interrupt
+
+// log block states
+#define TELEMETRY_LOG_IDLE			0			// loaded, may be replaced
+#define TELEMETRY_LOG_STREAMING		1			// being clocked out
+#define TELEMETRY_LOG_SENT			2			// clocked out completely
+
+//----- Global Variables -------------------------------------------------------
+PIN_DEFINE(telemetrySs, TELEMETRY_SS)
+PIN_DEFINE(telemetryMiso, TELEMETRY_MISO)
+
+static telemetry_T telemetry_work;					// filled by the main loop
+static telemetry_T telemetry_buf[2];				// published snapshots
+static volatile unsigned char telemetry_front = 0;	// buffer a new transfer reads
+static volatile unsigned char telemetry_reading = TELEMETRY_NONE;	// buffer being streamed
+static unsigned char* telemetry_ptr;
+static unsigned char telemetry_len = 0;
+
+#ifdef SAMPLELOG_ENABLE
+static samplelog_block_T telemetry_log;				// block the next TELEMETRY_LOG sends
+static volatile unsigned char telemetry_log_state = TELEMETRY_LOG_IDLE;
+static unsigned char telemetry_log_closed = 0;		// telemetry_log will not grow any more
+static unsigned short telemetry_log_cursor = 0;		// sequence number of the next block to send
+#endif
+
+//----- Functions --------------------------------------------------------------
+
+ISR(SPI_STC_vect)
+{
+	unsigned char byte = SPDR;
+
+	if (byte == TELEMETRY_READ)
+	{
+		// latch the front buffer for the whole transfer
+		telemetry_reading = telemetry_front;
+		telemetry_ptr = (unsigned char*)&telemetry_buf[telemetry_front];
+		telemetry_len = sizeof(telemetry_T);
+#ifdef SAMPLELOG_ENABLE
+		if (telemetry_log_state == TELEMETRY_LOG_STREAMING)
+			telemetry_log_state = TELEMETRY_LOG_IDLE;
+#endif
+	}
+#ifdef SAMPLELOG_ENABLE
+	else if (byte == TELEMETRY_LOG)
+	{
+		telemetry_reading = TELEMETRY_NONE;
+		telemetry_log_state = TELEMETRY_LOG_STREAMING;
+		telemetry_ptr = (unsigned char*)&telemetry_log;
+		telemetry_len = sizeof(samplelog_block_T);
+	}
+#endif
+
+	if (telemetry_len)
+	{
+		SPDR = *telemetry_ptr++;
+		if (--telemetry_len == 0)
+		{
+			telemetry_reading = TELEMETRY_NONE;
+#ifdef SAMPLELOG_ENABLE
+			if (telemetry_log_state == TELEMETRY_LOG_STREAMING)
+				telemetry_log_state = TELEMETRY_LOG_SENT;
+#endif
+		}
+	}
+	else
+		SPDR = TELEMETRY_ACK;
+}
+
+void telemetryInit(void)
+{
+	memset(&telemetry_work, 0, sizeof(telemetry_work));
+	telemetry_work.count = TELEMETRY_SENSORS;
+	memcpy(&telemetry_buf[0], &telemetry_work, sizeof(telemetry_T));
+	memcpy(&telemetry_buf[1], &telemetry_work, sizeof(telemetry_T));
+
+	telemetryMisoOutput();
+	telemetrySsHigh();						// pull-up keeps us deselected without a host
+	SPCR = (1 << SPE) | (1 << SPIE);
+	SPDR = TELEMETRY_ACK;
+}
+
+void telemetrySample(unsigned char sensor, dallas_rom_id_T* rom, short temp)
+{
+	telemetry_sensor_T* entry;
+
+	if (sensor >= TELEMETRY_SENSORS)
+		return;
+
+	entry = &telemetry_work.sensor[sensor];
+	entry->rom = *rom;
+	entry->temp = temp;
+	entry->time = systimeSeconds();
+	entry->last_error = DALLAS_NO_ERROR;
+}
+
+void telemetryError(unsigned char sensor, unsigned char error)
+{
+	if (sensor >= TELEMETRY_SENSORS)
+		return;
+
+	telemetry_work.sensor[sensor].errors++;
+	telemetry_work.sensor[sensor].last_error = error;
+}
+
+void telemetryPublish(void)
+{
+	unsigned char back;
+	unsigned char busy;
+
+	cli();
+	// with SS high no transfer is in progress,
+	// so a transfer the host cut short does not keep its buffer latched
+	if (telemetrySsRead())
+		telemetry_reading = TELEMETRY_NONE;
+	back = telemetry_front ^ 1;
+	busy = (telemetry_reading == back);
+	sei();
+
+	// a new transfer always latches the front buffer, so the back one
+	// stays ours until the swap below
+	if (busy)
+		return;
+
+	telemetry_work.seq++;
+	telemetry_work.uptime = systimeSeconds();
+	memcpy(&telemetry_buf[back], &telemetry_work, sizeof(telemetry_T));
+	telemetry_front = back;
+}
+
+#ifdef SAMPLELOG_ENABLE
+void telemetryLogService(void)
+{
+	samplelog_block_T block;
+	unsigned char state;
+	unsigned char kind;
+
+	cli();
+	if (telemetrySsRead() && (telemetry_log_state == TELEMETRY_LOG_STREAMING))
+		telemetry_log_state = TELEMETRY_LOG_IDLE;	// cut short, send it again
+	state = telemetry_log_state;
+	sei();
+
+	if (state == TELEMETRY_LOG_STREAMING)
+		return;
+
+	if ((state == TELEMETRY_LOG_SENT) && telemetry_log_closed)
+	{
+		telemetry_log_cursor = telemetry_log.seq + 1;
+		samplelogDrained(telemetry_log_cursor);
+	}
+
+	kind = samplelogRead(telemetry_log_cursor, &block);
+	if (kind == SAMPLELOG_NONE)
+	{
+		block.seq = telemetry_log_cursor;
+		block.time = 0;
+		block.len = 0;
+	}
+	telemetry_log_cursor = block.seq;
+
+	// the interrupt may have started a transfer since the check above
+	cli();
+	if (telemetry_log_state != TELEMETRY_LOG_STREAMING)
+	{
+		telemetry_log = block;
+		telemetry_log_closed = (kind == SAMPLELOG_CLOSED);
+		telemetry_log_state = TELEMETRY_LOG_IDLE;
+	}
+	sei();
+}
+#endif
+
+#endif
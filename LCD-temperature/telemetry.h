@@ -0,0 +1,83 @@
+//*****************************************************************************
+// File Name	: telemetry.h
+// Title		: SPI slave telemetry endpoint
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// The main loop fills a working copy with telemetrySample()/telemetryError()
+// and publishes it once per round with telemetryPublish(). Published
+// snapshots are double buffered: the SPI interrupt always streams a complete
+// buffer and the main loop never waits for the host.
+//
+// Protocol: the host sends TELEMETRY_READ followed by sizeof(telemetry_T)
+// filler bytes (0x00). The snapshot is clocked out, little endian, during the
+// fillers. TELEMETRY_READ restarts the stream at any point.
+//
+// With SAMPLELOG_ENABLE, TELEMETRY_LOG followed by SAMPLELOG_BLOCK_SIZE
+// fillers clocks out the next sample log block (see samplelog.h). Once a
+// block has been sent completely the main loop moves on to the next one
+// within a round; until then, and after a transfer cut short, the same block
+// is sent again. A block that was still open is resent with the rows added
+// since. An empty block (len 0) means nothing is logged yet.
+//*****************************************************************************
+
+#ifndef telemetry_h
+#define telemetry_h
+
+//----- Include Files ---------------------------------------------------------
+#include "dallas.h"
+#include "telemetryconf.h"
+#include "samplelog.h"
+
+//----- Defines ---------------------------------------------------------------
+#define TELEMETRY_READ				'T'			// start streaming the snapshot
+#define TELEMETRY_LOG				'L'			// start streaming the next log block
+#define TELEMETRY_ACK				'#'			// returned for any other byte
+
+//----- Typedefs --------------------------------------------------------------
+
+typedef struct telemetry_sensor_S
+{
+	dallas_rom_id_T rom;			// ROM ID of the sensor
+	short temp;						// last reading in 1/16 degrees
+	unsigned long time;				// systimeSeconds() of the last reading
+	unsigned short errors;			// failed readings since boot
+	unsigned char last_error;		// last dallas error code, DALLAS_NO_ERROR if none
+} telemetry_sensor_T;
+
+typedef struct telemetry_S
+{
+	unsigned char seq;				// incremented on every publish
+	unsigned char count;			// number of sensors
+	unsigned long uptime;			// systimeSeconds() at publish
+	telemetry_sensor_T sensor[TELEMETRY_SENSORS];
+} telemetry_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// telemetryInit()
+//     clears the snapshots and enables the SPI slave
+void telemetryInit(void);
+
+// telemetrySample()
+//     stores a reading of the given sensor in the working copy
+void telemetrySample(unsigned char sensor, dallas_rom_id_T* rom, short temp);
+
+// telemetryError()
+//     counts a failed reading of the given sensor in the working copy
+void telemetryError(unsigned char sensor, unsigned char error);
+
+// telemetryPublish()
+//     makes the working copy visible to the host
+//     skipped if the host is still reading the only free buffer,
+//     the next publish then carries the changes
+void telemetryPublish(void);
+
+#ifdef SAMPLELOG_ENABLE
+// telemetryLogService()
+//     advances the log read-out cursor past a block the host has read
+//     and loads the block to send next, call once per round
+void telemetryLogService(void);
+#endif
+
+#endif
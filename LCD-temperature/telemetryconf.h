@@ -0,0 +1,19 @@
+//*****************************************************************************
+// File Name	: telemetryconf.h
+// Title		: SPI telemetry endpoint configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef TELEMETRYCONF_H
+#define TELEMETRYCONF_H
+
+// Uncomment to serve readings over SPI, or pass -DTELEMETRY_ENABLE
+// The SPI slave select is PB2, so LCD Data0 moves from B2 to D3
+//#define TELEMETRY_ENABLE
+
+// Number of sensors in the snapshot
+#define TELEMETRY_SENSORS			3
+
+#endif
@@ -0,0 +1,75 @@
+//*****************************************************************************
+// File Name	: cmdqueue.c
+// Title		: Single producer, single consumer command ring
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "hal.h"				// include interrupt locking and barriers
+#include "cmdqueue.h"
+
+// the depth, up to CMDQUEUE_SIZE, goes in the low nibble of an ACK_DEPTH reply,
+// 16 would make it LINK_NAK
+#if (CMDQUEUE_SIZE & (CMDQUEUE_SIZE - 1)) || (CMDQUEUE_SIZE > 8)
+#error "CMDQUEUE_SIZE must be a power of two no larger than 8"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+static cmdqueue_entry_T cmdqueue_ring[CMDQUEUE_SIZE];
+static volatile unsigned char cmdqueue_head = 0;	// free-running, written by the interrupt
+static volatile unsigned char cmdqueue_tail = 0;	// free-running, written by the main loop
+static volatile unsigned short cmdqueue_dropped = 0;
+
+//----- Functions --------------------------------------------------------------
+
+unsigned char cmdqueuePush(const cmdqueue_entry_T* entry)
+{
+	unsigned char head = cmdqueue_head;
+
+	if ((unsigned char)(head - cmdqueue_tail) >= CMDQUEUE_SIZE)
+	{
+		cmdqueue_dropped++;
+		return 0;
+	}
+
+	// fill the slot before publishing it, the ring is not volatile so the compiler
+	// has to be kept from sinking the copy below the index store
+	cmdqueue_ring[head & (CMDQUEUE_SIZE - 1)] = *entry;
+	HAL_BARRIER();
+	cmdqueue_head = head + 1;
+	return 1;
+}
+
+unsigned char cmdqueuePop(cmdqueue_entry_T* entry)
+{
+	unsigned char tail = cmdqueue_tail;
+
+	if (tail == cmdqueue_head)
+		return 0;
+
+	// read the slot only after head showed it filled, and copy it out before
+	// handing it back
+	HAL_BARRIER();
+	*entry = cmdqueue_ring[tail & (CMDQUEUE_SIZE - 1)];
+	HAL_BARRIER();
+	cmdqueue_tail = tail + 1;
+	return 1;
+}
+
+unsigned char cmdqueueDepth(void)
+{
+	return (unsigned char)(cmdqueue_head - cmdqueue_tail);
+}
+
+unsigned short cmdqueueDropped(void)
+{
+	unsigned short dropped;
+
+	// two byte counter, the interrupt may update it between the halves
+	HAL_LOCK(state);
+	dropped = cmdqueue_dropped;
+	HAL_UNLOCK(state);
+	return dropped;
+}
@@ -0,0 +1,50 @@
+//*****************************************************************************
+// File Name	: cmdqueue.h
+// Title		: Single producer, single consumer command ring
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// The SPI interrupt pushes each complete command, the main loop pops them
+// in order. The interrupt only writes cmdqueue_head and the main loop only
+// writes cmdqueue_tail, both single bytes, so neither side has to disable
+// interrupts. A command pushed into a full ring is dropped and counted.
+//*****************************************************************************
+
+#ifndef cmdqueue_h
+#define cmdqueue_h
+
+//----- Include Files ---------------------------------------------------------
+#include "cmdqueueconf.h"
+
+//----- Defines ---------------------------------------------------------------
+#define CMDQUEUE_ARGS				4			// bytes after the command byte
+
+//----- Typedefs --------------------------------------------------------------
+
+typedef struct cmdqueue_entry_S
+{
+	unsigned char cmd;
+	unsigned char arg[CMDQUEUE_ARGS];
+} cmdqueue_entry_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// cmdqueuePush()
+//     appends a command, called from the SPI interrupt only
+//     returns 0 if the ring was full and the command was dropped
+unsigned char cmdqueuePush(const cmdqueue_entry_T* entry);
+
+// cmdqueuePop()
+//     removes the oldest command, called from the main loop only
+//     returns 0 if the ring was empty
+unsigned char cmdqueuePop(cmdqueue_entry_T* entry);
+
+// cmdqueueDepth()
+//     returns the number of queued commands, 0 to CMDQUEUE_SIZE
+unsigned char cmdqueueDepth(void);
+
+// cmdqueueDropped()
+//     returns the number of commands dropped since boot, wraps at 65535
+unsigned short cmdqueueDropped(void);
+
+#endif
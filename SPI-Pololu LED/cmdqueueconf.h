@@ -0,0 +1,17 @@
+//*****************************************************************************
+// File Name	: cmdqueueconf.h
+// Title		: SPI command queue configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef CMDQUEUECONF_H
+#define CMDQUEUECONF_H
+
+// Number of decoded commands the SPI interrupt can queue ahead of the main
+// loop, must be a power of two no larger than 8, a full queue of 16 would
+// reply with the depth 0xF0 (LINK_NAK in controller.c)
+#define CMDQUEUE_SIZE				8
+
+#endif
@@ -0,0 +1,1040 @@
+//*****************************************************************************
+// File Name	: controller.c
+// Title		: SPI protocol and command dispatch of the LED controller
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+#include "hal.h"
+#include "systime.h"
+#include "profile.h"
+#include "cmdqueue.h"
+#include "ledstrip.h"
+#include "render.h"
+#include "effect.h"
+#include "sweep.h"
+#include "tick.h"
+#include "fade.h"
+#include "crc8.h"
+#include "persist.h"
+#include "controller.h"
+
+#define ACK '#'
+#define READY '^'
+#define DONE '%'
+#define MESSAGE '#'
+#define FAIL '½'
+
+/* After the last byte of a command the reply to the next byte is ACK_DEPTH ored with the
+   number of commands waiting in the queue, including this one, or ACK_DROPPED if the queue
+   was full and the command was lost. A host that keeps the depth below CMDQUEUE_SIZE can
+   send commands back to back without waiting for the main loop. */
+#define ACK_DEPTH 0xE0
+#define ACK_DROPPED 0xFF
+
+#define COLOR 'c'
+#define EXECUTE 'E'
+#define LCOLOR 'l'
+#define HCOLOR 'h'
+#define SWEEP 'S'
+
+/* Sweep colour stops (sweep.h): 'l' and 'h' set the first two and make a two stop sweep.
+   'M', index, red, green, blue sets stop index and makes index + 1 stops, so a host sends
+   the stops in order. The fourth byte of 'S' selects the easing curve. */
+#define STOP 'M'
+
+/* 'B', brightness: scales everything sent to the strip by (brightness + 1) / 256 and resends
+   the current colours, no frame has to be uploaded again. */
+#define BRIGHTNESS 'B'
+
+/* Crossfade (fade.h): 'X', duration high byte, duration low byte in ms, now. With now set every
+   LED fades from the front buffer to the colours set with 'C' right away. Otherwise the next
+   frame upload fades in over the duration instead of replacing the front buffer at once. The
+   target becomes the front buffer as the fade starts, the colours faded from are kept in the
+   spare buffer until it is done. 'C' only stores its colour, uploads and fades in between
+   leave it alone. */
+#define CROSSFADE 'X'
+#define FADE_COLOR 'C'
+#define FADE_FRAME_MS 20
+
+/* Frame upload: the host sends 'F', the index of the first LED, the number of LEDs n
+   and then n red, green, blue triplets. The ISR stores them straight into the back buffer,
+   LEDs past LED_COUNT are dropped. The back buffer is a copy of the front buffer when an
+   upload starts, so the LEDs it leaves out keep what is shown. Once the last byte is in, the
+   main loop swaps the buffers, copies the new front buffer into the back one and sends it to
+   the strip. An upload that starts before the main loop has taken the previous one, or before
+   the copy is done, is dropped whole: its bytes are read but not stored and the reply after
+   the last one is ACK_DROPPED, so the host sends it again. */
+#define FRAME 'F'
+
+/* Encoded frame uploads, decoded by the ISR into the back buffer and shown like 'F', over the
+   copy of the front buffer it holds when the upload starts. Each has the same header, the
+   command, the first LED and a count n, and then:
+   'U'  n runs of length, red, green, blue, the runs follow each other from the first LED
+   'I'  n LEDs as 4 bit palette indexes, two per byte, high nibble first
+   'Y'  n segments of first, end, red, green, blue, filling LEDs [first, end) counted from
+        the first LED of the header; LEDs outside the segments keep the colour they have in
+        the front buffer, see 'F'
+   'p', index, red, green, blue sets one of the PALETTE_SIZE palette entries for 'I'. It is
+   stored by the ISR, so it applies to the next frame without waiting for the main loop. */
+#define FRAME_RLE 'U'
+#define FRAME_PALETTE 'I'
+#define FRAME_FILL 'Y'
+#define PALETTE 'p'
+#define PALETTE_SIZE 16
+
+/* Rendering without a frame buffer (render.h): 'R', mode, step, speed. RENDER_SOLID uses the
+   'c' colour, the other modes go from the 'l' to the 'h' colour. Mode 0 returns to the LED
+   buffers, a frame upload, 'E' or 'S' do too. 'G', length, red, green, blue appends a segment
+   for RENDER_SEGMENTS, length 0 clears the list. */
+#define RENDER 'R'
+#define SEGMENT 'G'
+
+/* Effects (effect.h): 'A', effect, speed, size runs an animation on the controller, stepped
+   every EFFECT_FRAME_MS. EFFECT_BREATHE uses the 'c' colour, EFFECT_CHASE and EFFECT_WAVE go
+   from the 'l' to the 'h' colour. Effect 0 returns to the LED buffers; a frame upload, 'E',
+   'S' or 'R' do too. */
+#define EFFECT 'A'
+
+/* Profile dump: the host sends 'P', the section number and then one filler byte (0)
+   for each byte of profile_entry_T. The row is clocked out, little endian, during the fillers. */
+#define PROFILE_DUMP 'P'
+
+/* Status: the host sends 'Q' and then one filler byte (0) for each byte of status_T, clocked
+   out little endian during the fillers like the profile dump. The main loop refreshes the
+   snapshot every STATUS_MS into the buffer the ISR is not sending and then flips the two,
+   so a read never waits for the main loop and never sees half an update. */
+#define STATUS 'Q'
+#define STATUS_MS 10
+
+#define STATUS_SWEEP 0x01           // sweeping
+#define STATUS_RENDER 0x02          // rendering a mode (render.h)
+#define STATUS_FADE 0x04            // crossfading
+#define STATUS_STREAMING 0x08       // a frame came in during the last FRAME_IDLE_MS
+#define STATUS_RESTORED 0x10        // the state was restored from the EEPROM at boot
+#define STATUS_EFFECT 0x20          // running an effect (effect.h)
+
+// fixed width and packed, the host build (host/loopback.h) sends the same bytes
+typedef struct __attribute__((packed)) status_S
+{
+    uint16_t frames;                // frames sent to the strip
+    uint16_t commands;              // complete commands received
+    uint16_t dropped;               // commands lost on a full queue
+    uint16_t resyncs;               // partial commands dropped
+    uint16_t rejects;               // framed commands rejected
+    uint32_t write_cycles;          // cycles taken by the last frame sent to the strip
+    uint8_t state;                  // STATUS_ flags
+    uint8_t queued;                 // commands waiting in the queue
+    rgb_color sweep_colour;         // colour the sweep is at
+    uint16_t free_ram;              // bytes between the heap and the stack
+} status_T;
+
+static status_T status[2];
+static unsigned char status_shown = 0;     // buffer the ISR sends
+static unsigned char status_reading = 0;   // 1 + buffer of a status read in progress, 0 for none
+
+static unsigned short spi_commands = 0;
+static unsigned short strip_frames = 0;
+static unsigned long strip_cycles = 0;
+
+static char ack = ACK;
+static unsigned char count = 0;
+static unsigned char data[5] = "     ";
+static unsigned char spi_reply;         // byte to send while the next one comes in
+
+#define LED_COUNT 21
+static rgb_color colours[LED_COUNT];
+static rgb_color colours2[LED_COUNT];
+static rgb_color colours3[LED_COUNT];
+static rgb_color *front = colours;     // sent by execute_colours()
+static rgb_color *back = colours2;     // written by frame uploads, swapped in by swap_colours()
+static rgb_color *spare = colours3;    // colours a fade starts from
+static rgb_color staged;               // set by 'C', what 'X' now fades every LED to
+
+/* Who owns the back buffer. The ISR only writes it in BACK_UPLOAD and only starts an upload
+   in BACK_FREE, the main loop only touches it in BACK_DONE and BACK_STALE. */
+#define BACK_FREE 0         // a copy of the front buffer, the next upload goes here
+#define BACK_UPLOAD 1       // an upload is being stored
+#define BACK_DONE 2         // a complete upload, its FRAME is queued
+#define BACK_STALE 3        // to be copied from the front buffer again
+
+static volatile unsigned char back_state = BACK_FREE;
+static unsigned char frame_drop;       // the upload came while the back buffer was not free
+
+static unsigned char frame_mode;       // FRAME, FRAME_RLE, FRAME_PALETTE or FRAME_FILL
+static unsigned char frame_start;      // first LED of the upload
+static unsigned int frame_led;  // next LED to write
+static unsigned char frame_count;      // LEDs still to come for FRAME_PALETTE
+static unsigned int frame_left = 0;    // bytes of the frame upload still to come
+static unsigned char frame_unit[5];    // bytes of the current triplet, run or segment
+static unsigned char frame_pos = 0;    // bytes in frame_unit
+
+static rgb_color palette[PALETTE_SIZE];
+
+#ifdef PROFILE_ENABLE
+static profile_entry_T dump_entry;
+#endif
+static unsigned char *dump_ptr;     // next byte of a profile or status dump
+static unsigned char dump_len = 0;  // bytes of the dump still to send
+
+/* Resync: the host sends each command in one burst. When the next byte of a command
+   comes more than SPI_RESYNC_US after the previous one, the partial command is dropped
+   and the byte starts a new one. A host that sees a wrong echo, for example after a byte
+   was overrun during a strip refresh, waits this long and sends the command again.
+   It has to be longer than a whole strip refresh, which delays the ISR unless
+   LED_STRIP_CHUNKED is set. */
+#define SPI_RESYNC_US 2000
+#define SPI_RESYNC_CYCLES ((unsigned long)SPI_RESYNC_US * (F_CPU / 1000000))
+
+static unsigned long spi_last = 0;  // systimeCycles() of the last byte
+static unsigned short spi_resyncs = 0;     // partial commands dropped
+
+/* Framed commands: LINK_SYNC, length, sequence number, the length bytes of one command
+   as above, crc. The crc is the Dallas CRC8 (crc8.h) of length, sequence number and
+   command. The command is decoded as it comes in but only queued, or for 'p' stored, once
+   the crc matched and the command ended on the last byte. The reply to the byte after the
+   crc is ACK_DEPTH or ACK_DROPPED as usual, or LINK_NAK ored with the reason.
+   Sequence numbers run 1 to 255 and wrap to 1, frames are only run in that order: after
+   a rejected or dropped frame the following ones are rejected too, and the host sends them
+   all again, in order, with the same sequence numbers. A frame with sequence number 0
+   always runs and starts the count again, for a host that just started. A frame up to 127
+   behind the last one run is acked without running it again, so a host that lost a reply
+   can simply repeat it. A rejected frame upload is not shown, the main loop copies the front
+   buffer over what it wrote into the back buffer. The profile dump is not framed, unframed
+   commands still work. */
+#define LINK_SYNC 0x7E
+#define LINK_NAK 0xF0
+#define LINK_NAK_CRC 0x01
+#define LINK_NAK_FRAMING 0x02      // the command was unknown, shorter or longer than the length
+#define LINK_NAK_SEQUENCE 0x03     // not the frame after the last one run
+
+#define LINK_IDLE 0
+#define LINK_LEN 1
+#define LINK_SEQ 2
+#define LINK_BODY 3
+#define LINK_CRC 4
+
+static unsigned char link_state = LINK_IDLE;
+static unsigned char link_left;     // command bytes still to come
+static unsigned char link_seq;      // sequence number of the frame
+static unsigned char link_last = 0; // sequence number of the last frame run
+static unsigned char link_crc;
+static unsigned char link_started;  // the command byte is in
+static unsigned char link_done;     // the command ended, waiting for the crc
+static unsigned char link_bad;      // the frame will be rejected
+static unsigned short link_rejects = 0;    // frames with a bad crc or length
+
+// An upload ended without being queued, what it stored is copied over again
+static void frame_abandon (void)
+{
+    if (back_state == BACK_UPLOAD){
+        back_state = BACK_STALE;
+    }
+}
+
+// Fill LEDs [first, end) of the back buffer, LEDs past LED_COUNT are dropped
+static void frame_fill (unsigned int first, unsigned int end, rgb_color c)
+{
+    if (end > LED_COUNT){
+        end = LED_COUNT;
+    }
+    while (first < end){
+        back[first++] = c;
+    }
+}
+
+// Start a frame upload from its header in data[], returns the number of bytes to come
+static unsigned int frame_begin (void)
+{
+    frame_mode = data[0];
+    frame_start = data[1];
+    frame_led = data[1];
+    frame_count = data[2];
+    frame_pos = 0;
+    frame_drop = back_state != BACK_FREE;
+    if (!frame_drop){
+        back_state = BACK_UPLOAD;
+    }
+    switch (frame_mode){
+        case(FRAME_RLE):
+            return data[2] * 4;
+        case(FRAME_PALETTE):
+            return (data[2] + 1) / 2;
+        case(FRAME_FILL):
+            return data[2] * 5;
+        default:
+            return data[2] * sizeof(rgb_color);
+    }
+}
+
+// Decode one byte of a frame upload into the back buffer
+static void frame_byte (unsigned char byte)
+{
+    unsigned char *u = frame_unit;
+
+    if (frame_drop){
+        return;
+    }
+    if (frame_mode == FRAME_PALETTE){
+        frame_fill(frame_led, frame_led + 1, palette[byte >> 4]);
+        frame_led++;
+        if (--frame_count){
+            frame_fill(frame_led, frame_led + 1, palette[byte & 0x0F]);
+            frame_led++;
+            frame_count--;
+        }
+        return;
+    }
+    u[frame_pos++] = byte;
+    switch (frame_mode){
+        case(FRAME_RLE):
+            if (frame_pos == 4){
+                frame_fill(frame_led, frame_led + u[0], (rgb_color){u[1], u[2], u[3]});
+                frame_led += u[0];
+                frame_pos = 0;
+            }
+            break;
+        case(FRAME_FILL):
+            if (frame_pos == 5){
+                frame_fill(frame_start + u[0], frame_start + u[1], (rgb_color){u[2], u[3], u[4]});
+                frame_pos = 0;
+            }
+            break;
+        default:
+            if (frame_pos == 3){
+                frame_fill(frame_led, frame_led + 1, (rgb_color){u[0], u[1], u[2]});
+                frame_led++;
+                frame_pos = 0;
+            }
+    }
+}
+
+// Queue a complete command and load the backpressure reply, returns 0 if the queue was full
+static unsigned char queue_command (void)
+{
+    cmdqueue_entry_T entry;
+    memcpy(&entry, data, sizeof(entry));
+    if (cmdqueuePush(&entry)){
+        spi_reply = ACK_DEPTH | cmdqueueDepth();
+        return 1;
+    }
+    spi_reply = ACK_DROPPED;
+    return 0;
+}
+
+// Run a complete command: store a palette entry or queue the command, returns 0 if dropped
+static unsigned char run_command (void)
+{
+    unsigned char queued;
+
+    spi_commands++;
+    if (data[0] == PALETTE){
+        palette[data[1] & (PALETTE_SIZE - 1)] = (rgb_color){data[2], data[3], data[4]};
+        spi_reply = ACK_DEPTH | cmdqueueDepth();
+        return 1;
+    }
+    if (data[0] == FRAME){
+        if (frame_drop){
+            spi_reply = ACK_DROPPED;
+            return 0;
+        }
+        queued = queue_command();
+        back_state = queued ? BACK_DONE : BACK_STALE;
+        return queued;
+    }
+    return queue_command();
+}
+
+// A command is complete, framed ones wait for their crc
+static void command_done (void)
+{
+    ack = ACK;
+    if (link_state != LINK_IDLE){
+        link_done = 1;
+        spi_reply = ack;
+    }else{
+        run_command();
+    }
+}
+
+// Framing of one byte, returns 0 if the byte goes on to the command decoding
+static unsigned char link_byte (unsigned char byte)
+{
+    unsigned char next = link_last == 255 ? 1 : link_last + 1;
+
+    switch (link_state){
+        case(LINK_IDLE):
+            if (byte != LINK_SYNC || count || frame_left){
+                return 0;
+            }
+            link_crc = 0;
+            link_state = LINK_LEN;
+            break;
+        case(LINK_LEN):
+            link_crc = crc8Update(link_crc, byte);
+            link_left = byte;
+            link_started = 0;
+            link_done = 0;
+            link_bad = 0;
+            link_state = LINK_SEQ;
+            break;
+        case(LINK_SEQ):
+            link_crc = crc8Update(link_crc, byte);
+            link_seq = byte;
+            link_state = link_left ? LINK_BODY : LINK_CRC;
+            break;
+        case(LINK_BODY):
+            link_crc = crc8Update(link_crc, byte);
+            if (--link_left == 0){
+                link_state = LINK_CRC;
+            }
+            if (link_started ? (link_done || (!count && !frame_left)) : (byte == PROFILE_DUMP || byte == STATUS)){
+                link_bad = 1;
+            }
+            if (link_bad){
+                break;
+            }
+            link_started = 1;
+            return 0;
+        default:
+            link_state = LINK_IDLE;
+            if (byte != link_crc || link_bad || !link_done){
+                count = 0;
+                frame_left = 0;
+                ack = ACK;
+                link_rejects++;
+                spi_reply = LINK_NAK | (byte != link_crc ? LINK_NAK_CRC : LINK_NAK_FRAMING);
+            }else if (link_seq == 0 || link_seq == next){
+                if (run_command()){
+                    link_last = link_seq;
+                }
+            }else if ((unsigned char)(link_last - link_seq) < 128){
+                // a repeat of a frame already run
+                spi_reply = ACK_DEPTH | cmdqueueDepth();
+            }else{
+                link_rejects++;
+                spi_reply = LINK_NAK | LINK_NAK_SEQUENCE;
+            }
+            frame_abandon();
+            return 1;
+    }
+    spi_reply = ack;
+    return 1;
+}
+
+unsigned char controllerSpiByte(unsigned char byte)
+{
+    unsigned long now = systimeCycles();
+    if (now - spi_last > SPI_RESYNC_CYCLES){
+        if (dump_len){
+            dump_len = 0;
+            status_reading = 0;
+            spi_resyncs++;
+        }
+        if (count || frame_left || link_state != LINK_IDLE){
+            count = 0;
+            frame_left = 0;
+            link_state = LINK_IDLE;
+            ack = ACK;
+            spi_resyncs++;
+            frame_abandon();
+        }
+    }
+    spi_last = now;
+    if (dump_len){
+        spi_reply = *dump_ptr++;
+        if (--dump_len == 0){
+            status_reading = 0;
+        }
+        return spi_reply;
+    }
+    if (link_byte(byte)){
+        return spi_reply;
+    }
+    if (frame_left){
+        frame_byte(byte);
+        if (--frame_left == 0){
+            data[0] = FRAME;
+            command_done();
+        }else{
+            spi_reply = ack;
+        }
+        return spi_reply;
+    }
+    data[count] = byte;
+    if (count == 0){
+        switch(data[0]) {
+            case(COLOR):
+                ack = COLOR;
+                break;
+            case(EXECUTE):
+                ack = EXECUTE;
+                break;
+            case(LCOLOR):
+                ack = LCOLOR;
+                break;
+            case(HCOLOR):
+                ack = HCOLOR;
+                break;
+            case(SWEEP):
+                ack = SWEEP;
+                break;
+            case(FRAME):
+                ack = FRAME;
+                break;
+            case(FRAME_RLE):
+                ack = FRAME_RLE;
+                break;
+            case(FRAME_PALETTE):
+                ack = FRAME_PALETTE;
+                break;
+            case(FRAME_FILL):
+                ack = FRAME_FILL;
+                break;
+            case(PALETTE):
+                ack = PALETTE;
+                break;
+            case(RENDER):
+                ack = RENDER;
+                break;
+            case(SEGMENT):
+                ack = SEGMENT;
+                break;
+            case(EFFECT):
+                ack = EFFECT;
+                break;
+            case(STOP):
+                ack = STOP;
+                break;
+            case(BRIGHTNESS):
+                ack = BRIGHTNESS;
+                break;
+            case(CROSSFADE):
+                ack = CROSSFADE;
+                break;
+            case(FADE_COLOR):
+                ack = FADE_COLOR;
+                break;
+            case(STATUS):
+                status_reading = status_shown + 1;
+                dump_ptr = (unsigned char *)&status[status_shown];
+                spi_reply = *dump_ptr++;
+                dump_len = sizeof(status_T) - 1;
+                ack = ACK;
+                return spi_reply;
+#ifdef PROFILE_ENABLE
+            case(PROFILE_DUMP):
+                ack = PROFILE_DUMP;
+                break;
+#endif
+            default:
+                ack = ACK;
+        }
+#ifdef PROFILE_ENABLE
+    } else if (count == 1 && data[0] == PROFILE_DUMP){
+        if (data[1] < PROFILE_SECTIONS){
+            profileRead(data[1], &dump_entry);
+        }else{
+            memset(&dump_entry, 0, sizeof(dump_entry));
+        }
+        dump_ptr = (unsigned char *)&dump_entry;
+        spi_reply = *dump_ptr++;
+        dump_len = sizeof(dump_entry) - 1;
+        count = 0;
+        return spi_reply;
+#endif
+    } else if (count == 2 && (data[0] == FRAME || data[0] == FRAME_RLE ||
+                              data[0] == FRAME_PALETTE || data[0] == FRAME_FILL)){
+        frame_left = frame_begin();
+        count = 0;
+        if (frame_left == 0){
+            data[0] = FRAME;
+            command_done();
+        }else{
+            spi_reply = ack;
+        }
+        return spi_reply;
+    } else if (count == 4){
+        count = 0;
+        command_done();
+        return spi_reply;
+    }
+    
+    spi_reply = ack;
+    if (ack != ACK){
+        count++;
+    }
+    return spi_reply;
+}
+
+
+static rgb_color sweep_lcolour = {250, 20, 5};
+static rgb_color sweep_hcolour = {100, 0, 250};
+static rgb_color sweep_colour = {0, 0, 0};
+static rgb_color colour = {255, 255, 255};
+
+static unsigned int sweep_time = 100;
+static unsigned char mult = 10;
+static unsigned char divider  = 1; 
+static char sweep = 0;
+static unsigned char easing = SWEEP_LINEAR;
+static unsigned short sweep_period = TICK_MS(10);   // ticks per sweep step, sweep_time * mult * 10 us
+static unsigned char front_shown = 0;  // the strip shows the front buffer as it is
+
+/* With LED_STRIP_DITHER (ledstripconf.h) the strip carries part of each level over to the
+   next refresh, so the front buffer is sent again every LED_STRIP_DITHER_MS while it is what
+   the strip shows. A 'c' changes the front buffer without showing it, that waits for 'E'. */
+#ifdef LED_STRIP_DITHER
+static unsigned short dither_next;
+#endif
+
+/* Persistence (persist.h): PERSIST_DELAY_MS after the last command, once no fade is running
+   and at least PERSIST_MIN_INTERVAL_S after the previous save, what is shown and how is saved
+   to the EEPROM, and at boot it is shown again right away.
+   Only changed records are written and the write goes on behind the main loop. Without
+   PERSIST_FRAME a frame is kept as its first LED. */
+#define SAVED_STATIC 0      // the LED buffers
+#define SAVED_SWEEP 1
+#define SAVED_RENDER 2
+#define SAVED_EFFECT 3
+
+typedef struct __attribute__((packed)) saved_S
+{
+    uint8_t mode;                   // SAVED_ mode
+    uint8_t brightness;
+    rgb_color colour;               // 'c', 'l' and 'h' colours
+    rgb_color lcolour;
+    rgb_color hcolour;
+    uint8_t sweep_time;             // 'S' arguments
+    uint8_t mult;
+    uint8_t divider;
+    uint8_t easing;
+    uint8_t stops;
+    rgb_color stop[SWEEP_STOPS];
+    uint8_t render_mode;            // 'R' arguments
+    uint8_t render_step;
+    uint8_t render_speed;
+    uint8_t segments;
+    render_segment_T segment[RENDER_SEGMENT_MAX];
+    uint8_t effect;                 // 'A' arguments
+    uint8_t effect_speed;
+    uint8_t effect_size;
+#ifdef PERSIST_FRAME
+    rgb_color frame[LED_COUNT];
+#else
+    rgb_color shown;                // first LED of the front buffer
+#endif
+} saved_T;
+
+static saved_T saved;                  // record being written
+static unsigned char brightness = 255;
+static unsigned char render_step = 0;
+static unsigned char render_speed = 0;
+static unsigned char effect_speed = 0;
+static unsigned char effect_size = 0;
+#define PERSIST_IDLE 0      // nothing to save
+#define PERSIST_QUIET 1     // waiting for PERSIST_DELAY_MS without commands
+#define PERSIST_DUE 2       // waiting for PERSIST_MIN_INTERVAL_S and the end of a fade
+static unsigned char persist_pending = PERSIST_IDLE;
+static unsigned short persist_due;
+static unsigned long persist_next = 0;  // systimeSeconds() the next save may start
+static unsigned char restored = 0;
+
+#define ACTIVITY_MS 5       // activity LED pulse when the colours change
+#define HEARTBEAT_MS 20     // heartbeat pulse when a sweep round starts
+#define IDLE_BLINK_MS 105   // heartbeat blink when nothing is shown
+
+
+
+// The front buffer changed, the back buffer has to follow before the next upload
+static void front_changed(){
+    HAL_LOCK(state);
+    if (back_state == BACK_FREE){
+        back_state = BACK_STALE;
+    }
+    HAL_UNLOCK(state);
+    front_shown = 0;
+}
+
+// Copy the front buffer into the back one if it is stale. The ISR does not touch the back
+// buffer then, so interrupts stay on.
+static void sync_back(){
+    if (back_state == BACK_STALE){
+        memcpy(back, front, sizeof(colours));
+        HAL_BARRIER();
+        back_state = BACK_FREE;
+    }
+}
+
+// Set colours of all leds in the front buffer
+static void set_colours(unsigned char r, unsigned char g, unsigned char b){
+    for(int i = 0; i < LED_COUNT; i++){
+        front[i] = (rgb_color){ r, g, b};
+    }
+    front_changed();
+    tickLed(TICK_LED_ACTIVITY, TICK_MS(ACTIVITY_MS), 0);
+}
+
+// Make the complete upload in the back buffer the front one, the old front buffer becomes the
+// spare one a fade starts from and the back buffer a copy of the new front one. The ISR leaves
+// the back buffer alone until then, BACK_DONE.
+static void swap_colours(){
+    rgb_color *tmp;
+
+    if (back_state != BACK_DONE){
+        return;
+    }
+    tmp = spare;
+    spare = front;
+    front = back;
+    back = tmp;
+    back_state = BACK_STALE;
+    sync_back();
+}
+
+// Count a frame sent to the strip that started at systimeCycles() start
+static void frame_sent(unsigned long start){
+    strip_cycles = systimeCycles() - start;
+    strip_frames++;
+}
+
+static void execute_colours(){
+    unsigned long start = systimeCycles();
+    led_strip_write(front, LED_COUNT);
+    frame_sent(start);
+    front_shown = 1;
+}
+
+// Ticks per sweep step from the 'S' arguments, sweep_time * mult * 10 us
+static void sweep_timing(){
+    sweep_period = TICK_MS(((unsigned long)sweep_time * mult + 50) / 100);
+    if (sweep_period == 0){
+        sweep_period = 1;
+    }
+}
+
+// Collect what is shown into the record and save it
+static void persist_state(){
+    saved.mode = effectActive() ? SAVED_EFFECT : renderActive() ? SAVED_RENDER :
+                 sweep ? SAVED_SWEEP : SAVED_STATIC;
+    saved.brightness = brightness;
+    saved.colour = colour;
+    saved.lcolour = sweep_lcolour;
+    saved.hcolour = sweep_hcolour;
+    saved.sweep_time = sweep_time;
+    saved.mult = mult;
+    saved.divider = divider;
+    saved.easing = easing;
+    saved.stops = sweepStops(saved.stop);
+    saved.render_mode = renderActive();
+    saved.render_step = render_step;
+    saved.render_speed = render_speed;
+    saved.segments = renderSegments(saved.segment);
+    saved.effect = effectActive();
+    saved.effect_speed = effect_speed;
+    saved.effect_size = effect_size;
+#ifdef PERSIST_FRAME
+    memcpy(saved.frame, front, sizeof(saved.frame));
+#else
+    saved.shown = front[0];
+#endif
+    persistSave(&saved);
+}
+
+// Show the saved state again, returns 0 if there is none
+static unsigned char persist_restore(){
+    unsigned char i;
+
+    if (!persistLoad(&saved) || saved.stops == 0 || saved.stops > SWEEP_STOPS ||
+        saved.segments > RENDER_SEGMENT_MAX || saved.effect > EFFECT_WAVE){
+        return 0;
+    }
+    brightness = saved.brightness;
+    led_strip_brightness(brightness);
+    colour = saved.colour;
+    sweep_lcolour = saved.lcolour;
+    sweep_hcolour = saved.hcolour;
+    for (i = 0; i < saved.stops; i++){
+        sweepStop(i, saved.stops, &saved.stop[i]);
+    }
+    sweep_time = saved.sweep_time;
+    mult = saved.mult;
+    divider = saved.divider;
+    easing = saved.easing;
+    sweepConfig(divider, easing);
+    sweep_timing();
+    renderSegment(0, 0);
+    for (i = 0; i < saved.segments; i++){
+        renderSegment(saved.segment[i].length, &saved.segment[i].color);
+    }
+    render_step = saved.render_step;
+    render_speed = saved.render_speed;
+    effect_speed = saved.effect_speed;
+    effect_size = saved.effect_size;
+
+    if (saved.mode == SAVED_EFFECT){
+        effectMode(saved.effect, effect_speed, effect_size);
+    }else if (saved.mode == SAVED_RENDER){
+        renderMode(saved.render_mode, render_step, render_speed);
+    }else if (saved.mode == SAVED_SWEEP){
+        sweep = 1;
+    }else{
+#ifdef PERSIST_FRAME
+        memcpy(front, saved.frame, sizeof(saved.frame));
+        front_changed();
+#else
+        set_colours(saved.shown.red, saved.shown.green, saved.shown.blue);
+#endif
+        execute_colours();
+    }
+    return 1;
+}
+
+// Refresh the status buffer the ISR is not sending and show it, skipped while a status
+// read is still sending that buffer
+static void status_update(unsigned char state){
+    unsigned char next;
+    status_T *s;
+
+    HAL_LOCK(sreg);
+    next = status_shown ^ 1;
+    if (status_reading != next + 1){
+        s = &status[next];
+        s->frames = strip_frames;
+        s->commands = spi_commands;
+        s->dropped = cmdqueueDropped();
+        s->resyncs = spi_resyncs;
+        s->rejects = link_rejects;
+        s->write_cycles = strip_cycles;
+        s->state = state;
+        s->queued = cmdqueueDepth();
+        s->sweep_colour = sweep_colour;
+        s->free_ram = halFreeRam();
+        status_shown = next;
+    }
+    HAL_UNLOCK(sreg);
+}
+
+#define FRAME_IDLE_MS 1000  // no heartbeat blink for this long after a frame
+
+static unsigned short frame_time = 0;
+static unsigned char streaming = 0;    // a frame came in during the last FRAME_IDLE_MS
+static unsigned short frame_next;
+static unsigned short status_next;
+static unsigned short fade_ms = 0;     // fade the next frame upload in over this time
+static unsigned char was_idle = 0;
+
+void controllerInit(void)
+{
+    persistInit(sizeof(saved_T));
+    restored = persist_restore();
+    if (!restored){
+        set_colours(0, 0, 0);
+        execute_colours();
+        sweep = 1;
+    }
+    sync_back();
+
+    frame_next = tickNow();
+    status_next = tickNow();
+}
+
+void controllerPoll(void)
+{
+    unsigned char idle;
+    cmdqueue_entry_T command;
+
+    if (fadeActive()){
+        if (tickDue(&frame_next, TICK_MS(FADE_FRAME_MS))){
+            unsigned long start = systimeCycles();
+            unsigned char more = fadeFrame();
+            frame_sent(start);
+            if (!more){
+                // the target, the front buffer, is on the strip now
+                front_shown = 1;
+            }
+        }
+    }else if (renderActive()){
+        if (tickDue(&frame_next, TICK_MS(RENDER_FRAME_MS))){
+            unsigned long start = systimeCycles();
+            renderColors(renderActive() == RENDER_SOLID ? &colour : &sweep_lcolour, &sweep_hcolour);
+            renderFrame();
+            frame_sent(start);
+        }
+    }else if (effectActive()){
+        if (tickDue(&frame_next, TICK_MS(EFFECT_FRAME_MS))){
+            unsigned long start = systimeCycles();
+            effectColors(&colour, &sweep_lcolour, &sweep_hcolour);
+            effectFrame();
+            frame_sent(start);
+        }
+    }else if (sweep){
+        if (tickDue(&frame_next, sweep_period)){
+            unsigned char state = sweepStep(&sweep_colour);
+            if (state & SWEEP_CHANGED){
+                set_colours(sweep_colour.red, sweep_colour.green, sweep_colour.blue);
+                execute_colours();
+            }
+            if (state & SWEEP_RESTART){
+                tickLed(TICK_LED_HEARTBEAT, TICK_MS(HEARTBEAT_MS), 0);
+            }
+        }
+    }
+
+#ifdef LED_STRIP_DITHER
+    if (front_shown && !fadeActive() && !renderActive() && !effectActive() &&
+        tickDue(&dither_next, TICK_MS(LED_STRIP_DITHER_MS))){
+        execute_colours();
+    }
+#endif
+
+    // blink the heartbeat while nothing is shown
+    if (streaming && (unsigned short)(tickNow() - frame_time) > TICK_MS(FRAME_IDLE_MS)){
+        streaming = 0;
+    }
+    idle = !fadeActive() && !renderActive() && !effectActive() && !sweep && !streaming;
+    if (idle != was_idle){
+        tickLed(TICK_LED_HEARTBEAT, idle ? TICK_MS(IDLE_BLINK_MS) : 0, TICK_MS(IDLE_BLINK_MS));
+        was_idle = idle;
+    }
+
+    if (tickDue(&status_next, TICK_MS(STATUS_MS))){
+        status_update((sweep ? STATUS_SWEEP : 0) | (renderActive() ? STATUS_RENDER : 0) |
+                      (fadeActive() ? STATUS_FADE : 0) | (streaming ? STATUS_STREAMING : 0) |
+                      (restored ? STATUS_RESTORED : 0) | (effectActive() ? STATUS_EFFECT : 0));
+    }
+
+    // the tick deadline wraps within the interval, so it is only checked while quiet
+    if (persist_pending == PERSIST_QUIET && (short)(tickNow() - persist_due) >= 0){
+        persist_pending = PERSIST_DUE;
+    }
+    if (persist_pending == PERSIST_DUE && !fadeActive() && (long)(systimeSeconds() - persist_next) >= 0){
+        persist_state();
+        persist_pending = PERSIST_IDLE;
+        persist_next = systimeSeconds() + PERSIST_MIN_INTERVAL_S;
+    }
+    persistPoll();
+    sync_back();
+
+    while (cmdqueuePop(&command)){
+        persist_pending = PERSIST_QUIET;
+        persist_due = tickNow() + TICK_MS(PERSIST_DELAY_MS);
+        switch (command.cmd){
+            case (FRAME):
+              renderMode(RENDER_OFF, 0, 0);
+              effectMode(EFFECT_OFF, 0, 0);
+              sweep = 0;
+              swap_colours();
+              if (fade_ms){
+                  fadeStart(spare, front, LED_COUNT, fade_ms / FADE_FRAME_MS);
+                  frame_next = tickNow();
+                  fade_ms = 0;
+              }else{
+                  fadeStop();
+                  execute_colours();
+              }
+              frame_time = tickNow();
+              streaming = 1;
+              break;
+            case ('c'):
+              set_colours(command.arg[0], command.arg[1], command.arg[2]);
+              colour.red = command.arg[0];
+              colour.green = command.arg[1];
+              colour.blue = command.arg[2];
+              break;
+            case (FADE_COLOR):
+              staged = (rgb_color){command.arg[0], command.arg[1], command.arg[2]};
+              tickLed(TICK_LED_ACTIVITY, TICK_MS(ACTIVITY_MS), 0);
+              break;
+            case ('E'):
+              fadeStop();
+              renderMode(RENDER_OFF, 0, 0);
+              effectMode(EFFECT_OFF, 0, 0);
+              execute_colours();
+              if (sweep){
+                  sweep ^= 1;
+              }
+              break;
+            case ('S'):
+              fadeStop();
+              renderMode(RENDER_OFF, 0, 0);
+              effectMode(EFFECT_OFF, 0, 0);
+              sweep ^= 1;
+              sweep_time = command.arg[0];
+              mult = command.arg[1] + 1;
+              divider = command.arg[2] + 1;
+              easing = command.arg[3];
+              sweepConfig(divider, easing);
+              sweep_timing();
+              frame_next = tickNow();
+              if (!sweep){
+                  set_colours(0, 0, 0);
+                  execute_colours();
+              }
+              break;
+            case ('l'):
+              sweep_lcolour = (rgb_color){command.arg[0], command.arg[1], command.arg[2]};
+              sweepStop(0, 2, &sweep_lcolour);
+              break;
+            case ('h'):
+              sweep_hcolour = (rgb_color){command.arg[0], command.arg[1], command.arg[2]};
+              sweepStop(1, 2, &sweep_hcolour);
+              break;
+            case (STOP):
+              sweepStop(command.arg[0], command.arg[0] + 1, &(rgb_color){command.arg[1], command.arg[2], command.arg[3]});
+              break;
+            case (CROSSFADE):
+              if (command.arg[2]){
+                  renderMode(RENDER_OFF, 0, 0);
+                  effectMode(EFFECT_OFF, 0, 0);
+                  sweep = 0;
+                  memcpy(spare, front, sizeof(colours));
+                  set_colours(staged.red, staged.green, staged.blue);
+                  fadeStart(spare, front, LED_COUNT, (((unsigned short)command.arg[0] << 8) | command.arg[1]) / FADE_FRAME_MS);
+                  frame_next = tickNow();
+              }else{
+                  fade_ms = ((unsigned short)command.arg[0] << 8) | command.arg[1];
+              }
+              break;
+            case (RENDER):
+              fadeStop();
+              effectMode(EFFECT_OFF, 0, 0);
+              renderMode(command.arg[0], command.arg[1], command.arg[2]);
+              render_step = command.arg[1];
+              render_speed = command.arg[2];
+              if (command.arg[0] != RENDER_OFF){
+                  sweep = 0;
+              }else{
+                  execute_colours();
+              }
+              break;
+            case (BRIGHTNESS):
+              brightness = command.arg[0];
+              led_strip_brightness(brightness);
+              if (!renderActive() && !effectActive()){
+                  execute_colours();
+              }
+              break;
+            case (SEGMENT):
+              renderSegment(command.arg[0], &(rgb_color){command.arg[1], command.arg[2], command.arg[3]});
+              break;
+            case (EFFECT):
+              fadeStop();
+              renderMode(RENDER_OFF, 0, 0);
+              effectMode(command.arg[0], command.arg[1], command.arg[2]);
+              effect_speed = command.arg[1];
+              effect_size = command.arg[2];
+              if (effectActive()){
+                  sweep = 0;
+                  frame_next = tickNow();
+              }else{
+                  execute_colours();
+              }
+              break;
+        }
+    }
+}
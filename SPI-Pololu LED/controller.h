@@ -0,0 +1,34 @@
+//*****************************************************************************
+// File Name	: controller.h
+// Title		: SPI protocol and command dispatch of the LED controller
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Everything the controller does between the SPI data register and the
+// strip driver: command parsing, frame decoding, framing, the command queue
+// and status snapshot, and the main loop that renders the frames. It goes
+// through hal.h and the driver headers only, so it builds for the host as
+// well (host/loopback.h). The protocol is described in controller.c.
+//*****************************************************************************
+
+#ifndef controller_h
+#define controller_h
+
+//----- Functions ---------------------------------------------------------------
+
+// controllerInit()
+//     blanks the strip and starts the sweep
+//     systimeInit() and tickInit() must have been called first
+void controllerInit(void);
+
+// controllerSpiByte()
+//     takes one byte received over SPI, returns the byte to send back
+//     during the next one, called from the SPI interrupt
+unsigned char controllerSpiByte(unsigned char byte);
+
+// controllerPoll()
+//     one pass of the main loop: the frame that is due, the status LEDs
+//     and snapshot, then the queued commands
+void controllerPoll(void);
+
+#endif
@@ -0,0 +1,22 @@
+//*****************************************************************************
+// File Name	: crc8.h
+// Title		: Dallas/Maxim CRC8
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// The 1-wire CRC8 of dallas_bitbang.c (polynomial x^8 + x^5 + x^4 + 1),
+// with the lookup table in program memory instead of SRAM. One table read
+// per byte, cheap enough to run in the SPI interrupt.
+//*****************************************************************************
+
+#ifndef crc8_h
+#define crc8_h
+
+//----- Functions ---------------------------------------------------------------
+
+// crc8Update()
+//     returns the crc after adding data to crc, start with crc 0
+//     running it over a block followed by its crc gives 0
+unsigned char crc8Update(unsigned char crc, unsigned char data);
+
+#endif
@@ -0,0 +1,220 @@
+//*****************************************************************************
+// File Name	: effect.c
+// Title		: Effects engine
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <string.h>
+#include "hal.h"				// include program memory support
+#include "effect.h"
+
+//----- Defines ---------------------------------------------------------------
+#define EFFECT_PHASE_SHIFT			4			// periodic effects, phase per frame is speed << 4
+
+//----- Typedefs --------------------------------------------------------------
+
+// the per LED fields are set up by effectFrame() for the frame being sent
+typedef struct effect_rainbow_S
+{
+	unsigned short hue;				// hue of the first LED, 8.8
+	unsigned char next;				// hue of the next LED
+} effect_rainbow_T;
+
+typedef struct effect_breathe_S
+{
+	unsigned short phase;
+	rgb_color color;				// every LED of the frame
+} effect_breathe_T;
+
+typedef struct effect_chase_S
+{
+	unsigned short head;			// LED of the head, 8.8
+	unsigned char dist;				// LEDs from the head back to the next LED
+	unsigned char fade;				// level lost per LED of the tail
+} effect_chase_T;
+
+typedef struct effect_wave_S
+{
+	unsigned short phase;			// phase of the first LED, 8.8
+	unsigned char next;				// phase of the next LED
+} effect_wave_T;
+
+//----- Global Variables -------------------------------------------------------
+static const unsigned char effect_hue[256] HAL_FLASH =		// red over the hue wheel, green and blue are a third later
+{
+	255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+	255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+	255,255,255,255,255,255,255,255,255,255,255,253,247,241,235,229,
+	223,217,211,205,199,193,187,181,175,169,163,157,151,145,139,133,
+	127,122,116,110,104, 98, 92, 86, 80, 74, 68, 62, 56, 50, 44, 38,
+	32, 26, 20, 14,  8,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  2,  8, 14, 20, 26,
+	32, 38, 44, 50, 56, 62, 68, 74, 80, 86, 92, 98,104,110,116,122,
+	127,133,139,145,151,157,163,169,175,181,187,193,199,205,211,217,
+	223,229,235,241,247,253,255,255,255,255,255,255,255,255,255,255,
+	255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+	255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+};
+
+static const unsigned char effect_sine[65] HAL_FLASH =		// 127 sin(x) over a quarter period
+{
+	0,  3,  6,  9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+	49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+	90, 92, 94, 96, 98,100,102,104,106,107,109,111,112,113,115,116,
+	117,118,120,121,122,122,123,124,125,125,126,126,126,127,127,127,
+	127
+};
+
+static unsigned char effect_mode = EFFECT_OFF;
+static unsigned char effect_speed;
+static unsigned char effect_size;
+static rgb_color effect_color;
+static rgb_color effect_low;
+static short effect_diff[3];						// high minus low color
+
+static union
+{
+	effect_rainbow_T rainbow;
+	effect_breathe_T breathe;
+	effect_chase_T chase;
+	effect_wave_T wave;
+} effect_state;
+
+//----- Functions --------------------------------------------------------------
+
+// 128 + 127 sin(x), x from 0 to 255 over a period
+static unsigned char effectSine(unsigned char x)
+{
+	unsigned char i = x & 0x3F;
+
+	if (x & 0x40)
+		i = 64 - i;
+	if (x & 0x80)
+		return 128 - halFlashByte(&effect_sine[i]);
+	return 128 + halFlashByte(&effect_sine[i]);
+}
+
+// low color to high color, level 0 to 255, halved so the products fit 16 bits
+static void effectBlend(rgb_color* color, unsigned char level)
+{
+	level >>= 1;
+	color->red = effect_low.red + ((effect_diff[0] * level) >> 7);
+	color->green = effect_low.green + ((effect_diff[1] * level) >> 7);
+	color->blue = effect_low.blue + ((effect_diff[2] * level) >> 7);
+}
+
+static void effectNext(rgb_color* color)
+{
+	unsigned char h;
+
+	switch (effect_mode)
+	{
+	case EFFECT_RAINBOW:
+		h = effect_state.rainbow.next;
+		color->red = halFlashByte(&effect_hue[h]);
+		color->green = halFlashByte(&effect_hue[(unsigned char)(h - 85)]);
+		color->blue = halFlashByte(&effect_hue[(unsigned char)(h - 170)]);
+		effect_state.rainbow.next += effect_size;
+		break;
+	case EFFECT_BREATHE:
+		*color = effect_state.breathe.color;
+		break;
+	case EFFECT_CHASE:
+		if (effect_state.chase.dist < effect_size)
+			effectBlend(color, 255 - effect_state.chase.dist * effect_state.chase.fade);
+		else
+			*color = effect_low;
+		// the LED after the head is the farthest behind it
+		if (effect_state.chase.dist == 0)
+			effect_state.chase.dist = EFFECT_LEDS;
+		effect_state.chase.dist--;
+		break;
+	case EFFECT_WAVE:
+		effectBlend(color, effectSine(effect_state.wave.next));
+		effect_state.wave.next += effect_size;
+		break;
+	default:
+		*color = effect_low;
+	}
+}
+
+void effectMode(unsigned char effect, unsigned char speed, unsigned char size)
+{
+	// an unknown effect would render the low color and be saved as a mode
+	if (effect > EFFECT_WAVE)
+		effect = EFFECT_OFF;
+	effect_mode = effect;
+	effect_speed = speed;
+	effect_size = size;
+	if (effect_mode == EFFECT_CHASE && effect_size == 0)
+		effect_size = 1;
+
+	// every effect starts from phase 0
+	memset(&effect_state, 0, sizeof(effect_state));
+}
+
+unsigned char effectActive(void)
+{
+	return effect_mode;
+}
+
+void effectColors(rgb_color* color, rgb_color* low, rgb_color* high)
+{
+	effect_color = *color;
+	effect_low = *low;
+	effect_diff[0] = high->red - low->red;
+	effect_diff[1] = high->green - low->green;
+	effect_diff[2] = high->blue - low->blue;
+}
+
+void effectFrame(void)
+{
+	unsigned short level;
+
+	switch (effect_mode)
+	{
+	case EFFECT_RAINBOW:
+		effect_state.rainbow.next = effect_state.rainbow.hue >> 8;
+		break;
+	case EFFECT_BREATHE:
+		level = effect_size + (((unsigned int)(255 - effect_size) * effectSine(effect_state.breathe.phase >> 8)) >> 8) + 1;
+		effect_state.breathe.color.red = (effect_color.red * level) >> 8;
+		effect_state.breathe.color.green = (effect_color.green * level) >> 8;
+		effect_state.breathe.color.blue = (effect_color.blue * level) >> 8;
+		break;
+	case EFFECT_CHASE:
+		effect_state.chase.dist = effect_state.chase.head >> 8;
+		effect_state.chase.fade = 255 / effect_size;
+		break;
+	case EFFECT_WAVE:
+		effect_state.wave.next = effect_state.wave.phase >> 8;
+		break;
+	}
+
+	led_strip_generate(effectNext, EFFECT_LEDS);
+
+	switch (effect_mode)
+	{
+	case EFFECT_RAINBOW:
+		effect_state.rainbow.hue += effect_speed << EFFECT_PHASE_SHIFT;
+		break;
+	case EFFECT_BREATHE:
+		effect_state.breathe.phase += effect_speed << EFFECT_PHASE_SHIFT;
+		break;
+	case EFFECT_CHASE:
+		effect_state.chase.head += effect_speed;
+		if (effect_state.chase.head >= EFFECT_LEDS << 8)
+			effect_state.chase.head -= EFFECT_LEDS << 8;
+		break;
+	case EFFECT_WAVE:
+		effect_state.wave.phase += effect_speed << EFFECT_PHASE_SHIFT;
+		break;
+	}
+}
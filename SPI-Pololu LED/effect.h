@@ -0,0 +1,59 @@
+//*****************************************************************************
+// File Name	: effect.h
+// Title		: Effects engine
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Animations that run on the controller, one effectFrame() per frame clock
+// tick, so the host sends one command instead of a stream of frames. Like
+// render.h the colors are generated per LED while the strip is written. The
+// waveforms come from tables in flash, a hue wheel and a quarter sine, so
+// per LED an effect only looks up, adds and does one 8 bit multiply per
+// channel. Each effect keeps its own state; they share the memory.
+//
+// speed is the change per frame: 1/4096 of a period for the periodic
+// effects, 1/256 LED for the chase. size depends on the effect:
+//
+//   EFFECT_RAINBOW   hue wheel along the strip, size is the hue step per LED
+//                    (256 is a full wheel)
+//   EFFECT_BREATHE   the color fades in and out on a sine, size is the
+//                    lowest level
+//   EFFECT_CHASE     a high color head with a tail of size LEDs fading into
+//                    the low color runs along the strip
+//   EFFECT_WAVE      a sine wave between low and high color, size is the
+//                    phase step per LED
+//*****************************************************************************
+
+#ifndef effect_h
+#define effect_h
+
+//----- Include Files ---------------------------------------------------------
+#include "effectconf.h"
+#include "ledstrip.h"
+
+//----- Defines ---------------------------------------------------------------
+#define EFFECT_OFF					0			// the strip shows the LED buffers
+#define EFFECT_RAINBOW				1
+#define EFFECT_BREATHE				2
+#define EFFECT_CHASE				3
+#define EFFECT_WAVE					4
+
+//----- Functions ---------------------------------------------------------------
+
+// effectMode()
+//     selects and restarts an effect, an unknown one is EFFECT_OFF
+void effectMode(unsigned char effect, unsigned char speed, unsigned char size);
+
+// effectActive()
+//     returns the current effect, EFFECT_OFF if none
+unsigned char effectActive(void);
+
+// effectColors()
+//     sets the color of EFFECT_BREATHE and the low and high colors
+void effectColors(rgb_color* color, rgb_color* low, rgb_color* high);
+
+// effectFrame()
+//     sends one frame of EFFECT_LEDS colors and steps the effect
+void effectFrame(void);
+
+#endif
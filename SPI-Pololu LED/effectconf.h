@@ -0,0 +1,18 @@
+//*****************************************************************************
+// File Name	: effectconf.h
+// Title		: Effects engine configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef EFFECTCONF_H
+#define EFFECTCONF_H
+
+// LEDs sent per effect frame, generated like RENDER_LEDS without a buffer
+#define EFFECT_LEDS					21
+
+// Time between effect frames, the frame clock the effects step on
+#define EFFECT_FRAME_MS				20
+
+#endif
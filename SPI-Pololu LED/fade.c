@@ -0,0 +1,84 @@
+//*****************************************************************************
+// File Name	: fade.c
+// Title		: Per LED crossfade between two color buffers
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "fade.h"
+
+//----- Global Variables -------------------------------------------------------
+static rgb_color* fade_from;
+static rgb_color* fade_to;
+static unsigned int fade_count;
+static unsigned short fade_left = 0;				// frames left to send
+static unsigned short fade_phase;					// 0.16 fixed point position
+static unsigned short fade_dphase;
+static unsigned char fade_alpha;					// position of the frame being sent
+
+// LED being generated
+static rgb_color* fade_f;
+static rgb_color* fade_t;
+
+//----- Functions --------------------------------------------------------------
+
+static unsigned char fadeMix(unsigned char from, unsigned char to)
+{
+	// split on the sign to keep the product in 16 bits
+	if (to >= from)
+		return from + (((unsigned int)(to - from) * fade_alpha) >> 8);
+	return from - (((unsigned int)(from - to) * fade_alpha) >> 8);
+}
+
+static void fadeNext(rgb_color* color)
+{
+	color->red = fadeMix(fade_f->red, fade_t->red);
+	color->green = fadeMix(fade_f->green, fade_t->green);
+	color->blue = fadeMix(fade_f->blue, fade_t->blue);
+	fade_f++;
+	fade_t++;
+}
+
+void fadeStart(rgb_color* from, rgb_color* to, unsigned int count, unsigned short frames)
+{
+	if (frames == 0)
+		frames = 1;
+
+	fade_from = from;
+	fade_to = to;
+	fade_count = count;
+	fade_left = frames;
+	fade_phase = 0;
+	fade_dphase = 0xFFFF / frames;
+}
+
+unsigned char fadeActive(void)
+{
+	return fade_left != 0;
+}
+
+unsigned char fadeFrame(void)
+{
+	if (fade_left == 0)
+		return 0;
+
+	if (--fade_left == 0)
+	{
+		led_strip_write(fade_to, fade_count);
+		return 0;
+	}
+
+	fade_phase += fade_dphase;
+	fade_alpha = fade_phase >> 8;
+	fade_f = fade_from;
+	fade_t = fade_to;
+	led_strip_generate(fadeNext, fade_count);
+	return 1;
+}
+
+void fadeStop(void)
+{
+	fade_left = 0;
+}
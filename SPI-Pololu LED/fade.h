@@ -0,0 +1,41 @@
+//*****************************************************************************
+// File Name	: fade.h
+// Title		: Per LED crossfade between two color buffers
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Each frame of a fade is generated while it is sent, see
+// led_strip_generate(), so the fade needs no buffer of its own. The fade
+// position is an 8.8 fixed point value that only adds per frame, each LED
+// channel is blended with one 8 bit multiply. The last frame sends the
+// target colors exactly.
+//*****************************************************************************
+
+#ifndef fade_h
+#define fade_h
+
+//----- Include Files ---------------------------------------------------------
+#include "ledstrip.h"
+
+//----- Functions ---------------------------------------------------------------
+
+// fadeStart()
+//     starts a fade of count LEDs from the colors in from to the ones in to
+//     over the given number of frames, at least 1. Both buffers are read
+//     on every frame, changes to them show up in the next frame.
+void fadeStart(rgb_color* from, rgb_color* to, unsigned int count, unsigned short frames);
+
+// fadeActive()
+//     returns 1 while a fade has frames left to send
+unsigned char fadeActive(void);
+
+// fadeFrame()
+//     sends the next frame of the fade
+//     returns 0 once the final frame, the target colors, has been sent
+unsigned char fadeFrame(void);
+
+// fadeStop()
+//     ends the fade where it is
+void fadeStop(void);
+
+#endif
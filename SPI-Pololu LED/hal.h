@@ -0,0 +1,85 @@
+//*****************************************************************************
+// File Name	: hal.h
+// Title		: What the controller logic needs from the chip
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// controller.c and the modules it uses reach the hardware only through this
+// header and the driver headers ledstrip.h, systime.h and tick.h. Built with
+// HAL_HOST defined they need no AVR headers at all, host/loopback.c then
+// stands in for the drivers and halFreeRam(), and the EEPROM is plain SRAM
+// that is ready at once.
+//*****************************************************************************
+
+#ifndef hal_h
+#define hal_h
+
+#ifdef HAL_HOST
+
+//----- Include Files ---------------------------------------------------------
+#include <string.h>
+
+//----- Defines ---------------------------------------------------------------
+#define HAL_FLASH
+#define halFlashByte(address)		(*(const unsigned char*)(address))
+
+#define HAL_EEPROM
+#define halEepromRead(dst, src, n)	memcpy((dst), (src), (n))
+#define halEepromWrite(address, byte)	(*(unsigned char*)(address) = (byte))
+#define halEepromReady()			1
+
+// nothing interrupts the host build
+#define HAL_LOCK(state)				unsigned char state = 0
+#define HAL_UNLOCK(state)			(void)(state)
+
+// keeps the compiler from moving memory accesses across it
+#define HAL_BARRIER()				__asm__ __volatile__("" ::: "memory")
+
+//----- Functions ---------------------------------------------------------------
+
+// halFreeRam()
+//     returns the bytes between the heap and the stack
+unsigned short halFreeRam(void);
+
+#else
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include <avr/pgmspace.h>		// include program memory support
+#include <avr/eeprom.h>			// include EEPROM support
+
+//----- Defines ---------------------------------------------------------------
+#define HAL_FLASH					PROGMEM
+#define halFlashByte(address)		pgm_read_byte(address)
+
+// a write only starts the byte, halEepromReady() is 0 until it is done
+#define HAL_EEPROM					EEMEM
+#define halEepromRead(dst, src, n)	eeprom_read_block((dst), (src), (n))
+#define halEepromWrite(address, byte)	eeprom_update_byte((address), (byte))
+#define halEepromReady()			eeprom_is_ready()
+
+// interrupts off until HAL_UNLOCK(), restoring the state they were in
+#define HAL_LOCK(state)				unsigned char state = SREG; cli()
+#define HAL_UNLOCK(state)			SREG = state
+
+// keeps the compiler from moving memory accesses across it, for data an interrupt
+// takes over once a volatile flag or index says so
+#define HAL_BARRIER()				__asm__ __volatile__("" ::: "memory")
+
+//----- Functions ---------------------------------------------------------------
+
+// halFreeRam()
+//     returns the bytes between the heap and the stack
+static inline unsigned short halFreeRam(void)
+{
+	extern char __heap_start;
+	extern char* __brkval;
+	char top;
+
+	return &top - (__brkval ? __brkval : &__heap_start);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,407 @@
+//*****************************************************************************
+// File Name	: bench.c
+// Title		: Benchmark and golden output check of the controller firmware
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+// Runs fixed command sequences through the client library into the loopback
+// (loopback.h) and reports, per frame sent to the strip, the SPI bytes the
+// controller took in, the passes of its main loop, the LEDs it generated and
+// the host time it all took. Every scenario runs in its own process, so it
+// starts from a freshly booted firmware and its output is always the same.
+//
+//     bench        report
+//     bench -c     also compare what was shown against the golden hashes
+//                  below, exit 1 on a difference
+//
+// The golden hashes were taken from this firmware. A change that alters
+// what is shown on purpose updates them from the output of bench.
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ledclient.h"
+#include "loopback.h"
+
+//----- Defines ---------------------------------------------------------------
+#define BENCH_BYTE_US				70			// host pacing per byte, see ledstrip.h
+#define BENCH_LEDS					21			// LED_COUNT of the firmware
+#define BENCH_FRAMES				500			// uploads per upload scenario
+#define BENCH_SECONDS				20			// simulated time of the timed scenarios
+
+//----- Typedefs --------------------------------------------------------------
+typedef struct bench_scenario_S
+{
+	const char* name;
+	void (*run)(ledclient_T* client);
+	unsigned long frames;			// golden frame count
+	unsigned long hash;				// golden hash of what was shown
+} bench_scenario_T;
+
+//----- Functions --------------------------------------------------------------
+
+// a frame that moves with n
+static void benchPattern(unsigned char* rgb, unsigned int n)
+{
+	unsigned int i;
+
+	for(i=0;i<BENCH_LEDS;i++)
+	{
+		rgb[i * 3] = n + i * 12;
+		rgb[i * 3 + 1] = n * 3 + i;
+		rgb[i * 3 + 2] = 255 - n - i * 5;
+	}
+}
+
+static void benchWait(ledclient_T* client, unsigned long ms)
+{
+	while (ms--)
+		ledclientIdle(client, 1000);
+}
+
+static void benchColor(ledclient_T* client)
+{
+	unsigned int n;
+
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		ledclientColor(client, n, n * 7, 255 - n);
+		ledclientExecute(client);
+	}
+	ledclientFlush(client);
+}
+
+static void benchFrame(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+	unsigned int n;
+
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		benchPattern(rgb, n);
+		ledclientFrame(client, 0, rgb, BENCH_LEDS);
+	}
+	ledclientFlush(client);
+}
+
+static void benchFramed(ledclient_T* client)
+{
+	ledclientFramed(client, 1);
+	benchFrame(client);
+}
+
+static ledclient_backend_T bench_backend;	// the loopback under benchCorrupt()
+static unsigned int bench_corrupt;			// transfers left to corrupt
+
+// Flips the crc of the last command while bench_corrupt lasts
+static int benchCorrupt(void* ctx, const unsigned char* tx, unsigned char* rx, unsigned int len)
+{
+	unsigned char bad[LEDCLIENT_BATCH + 1];
+
+	if (!bench_corrupt || len < 2)
+		return bench_backend.transfer(ctx, tx, rx, len);
+	bench_corrupt--;
+	memcpy(bad, tx, len);
+	bad[len - 2] ^= 0x5A;
+	return bench_backend.transfer(ctx, bad, rx, len);
+}
+
+// one framed frame fails the crc until it is given up, the ones after it still show
+static void benchFramedDrop(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+
+	ledclientFramed(client, 1);
+	benchPattern(rgb, 0);
+	ledclientFrame(client, 0, rgb, BENCH_LEDS);
+	ledclientFlush(client);
+
+	bench_backend = client->backend;
+	client->backend.transfer = benchCorrupt;
+	bench_corrupt = LEDCLIENT_RETRIES;
+	benchPattern(rgb, 1);
+	ledclientFrame(client, 0, rgb, BENCH_LEDS);
+	ledclientFlush(client);
+
+	benchFrame(client);
+}
+
+static void benchRle(ledclient_T* client)
+{
+	unsigned char command[3 + 3 * 4];
+	unsigned int n;
+
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		unsigned char split = 1 + n % 19;
+		unsigned char runs[3 * 4] = {
+			split, n, 0, 255 - n,
+			1, 255, 255, 255,
+			BENCH_LEDS - 1 - split, 0, n, 0 };
+
+		command[0] = 'U';
+		command[1] = 0;
+		command[2] = 3;
+		memcpy(&command[3], runs, sizeof(runs));
+		ledclientSend(client, command, sizeof(command));
+	}
+	ledclientFlush(client);
+}
+
+// full frames, then uploads of single LEDs and fills that keep the rest of what is shown
+static void benchPartial(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+	unsigned char command[3 + 5];
+	unsigned int n;
+
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		if (n % 100 == 0)
+		{
+			benchPattern(rgb, n);
+			ledclientFrame(client, 0, rgb, BENCH_LEDS);
+		}
+		else if (n % 2)
+		{
+			rgb[0] = n;
+			rgb[1] = 0;
+			rgb[2] = 255 - n;
+			ledclientFrame(client, n % BENCH_LEDS, rgb, 1);
+		}
+		else
+		{
+			command[0] = 'Y';
+			command[1] = n % BENCH_LEDS;
+			command[2] = 1;
+			command[3] = 0;
+			command[4] = 2;
+			command[5] = 0;
+			command[6] = n;
+			command[7] = n * 5;
+			ledclientSend(client, command, sizeof(command));
+		}
+	}
+	ledclientFlush(client);
+}
+
+static void benchPalette(ledclient_T* client)
+{
+	unsigned char command[3 + (BENCH_LEDS + 1) / 2];
+	unsigned int i, n;
+
+	for(i=0;i<16;i++)
+		ledclientPalette(client, i, i * 16, 255 - i * 16, i * i);
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		command[0] = 'I';
+		command[1] = 0;
+		command[2] = BENCH_LEDS;
+		for(i=0;i<(BENCH_LEDS + 1) / 2;i++)
+			command[3 + i] = (((n + i * 2) & 0x0F) << 4) | ((n + i * 2 + 1) & 0x0F);
+		ledclientSend(client, command, sizeof(command));
+	}
+	ledclientFlush(client);
+}
+
+static void benchFill(ledclient_T* client)
+{
+	unsigned char command[3 + 2 * 5];
+	unsigned int n;
+
+	for(n=0;n<BENCH_FRAMES;n++)
+	{
+		command[0] = 'Y';
+		command[1] = 0;
+		command[2] = 2;
+		command[3] = 0;
+		command[4] = BENCH_LEDS;
+		command[5] = 0;
+		command[6] = 0;
+		command[7] = n;
+		command[8] = n % BENCH_LEDS;
+		command[9] = n % BENCH_LEDS + 3;
+		command[10] = 255;
+		command[11] = n;
+		command[12] = 0;
+		ledclientSend(client, command, sizeof(command));
+	}
+	ledclientFlush(client);
+}
+
+// the sweep runs from boot, 'E' stops it and 'S' starts it again configured
+static void benchSweep(ledclient_T* client)
+{
+	ledclientExecute(client);
+	ledclientLow(client, 250, 20, 5);
+	ledclientHigh(client, 100, 0, 250);
+	ledclientSweep(client, 100, 10, 1, 0);
+	benchWait(client, BENCH_SECONDS * 1000UL);
+}
+
+static void benchSweepEased(ledclient_T* client)
+{
+	ledclientExecute(client);
+	ledclientStop(client, 0, 255, 0, 0);
+	ledclientStop(client, 1, 0, 255, 0);
+	ledclientStop(client, 2, 0, 0, 255);
+	ledclientStop(client, 3, 255, 255, 255);
+	ledclientSweep(client, 50, 10, 2, 3);
+	benchWait(client, BENCH_SECONDS * 1000UL);
+}
+
+static void benchGradient(ledclient_T* client)
+{
+	ledclientLow(client, 255, 0, 0);
+	ledclientHigh(client, 0, 0, 255);
+	ledclientRender(client, 2, 12, 3);
+	benchWait(client, BENCH_SECONDS * 1000UL);
+}
+
+// every effect for a quarter of the time, colours set once
+static void benchEffects(ledclient_T* client)
+{
+	ledclientColor(client, 255, 120, 20);
+	ledclientLow(client, 0, 0, 40);
+	ledclientHigh(client, 255, 255, 255);
+	ledclientEffect(client, 1, 40, 12);
+	benchWait(client, BENCH_SECONDS * 250UL);
+	ledclientEffect(client, 2, 60, 16);
+	benchWait(client, BENCH_SECONDS * 250UL);
+	ledclientEffect(client, 3, 90, 6);
+	benchWait(client, BENCH_SECONDS * 250UL);
+	ledclientEffect(client, 4, 30, 24);
+	benchWait(client, BENCH_SECONDS * 250UL);
+}
+
+static void benchCrossfade(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+	unsigned int n;
+
+	for(n=0;n<BENCH_SECONDS;n++)
+	{
+		benchPattern(rgb, n * 40);
+		ledclientCrossfade(client, 800, 0);
+		ledclientFrame(client, 0, rgb, BENCH_LEDS);
+		benchWait(client, 1000);
+	}
+}
+
+// 'C' staged before uploads and again during the fade, the fade ends on the first one
+static void benchFadeColor(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+	unsigned int n;
+
+	for(n=0;n<BENCH_SECONDS;n++)
+	{
+		ledclientFadeColor(client, n * 10, 0, 200 - n * 10);
+		benchPattern(rgb, n * 40);
+		ledclientFrame(client, 0, rgb, BENCH_LEDS);
+		ledclientCrossfade(client, 400, 1);
+		benchWait(client, 200);
+		ledclientFadeColor(client, 0, 255, 0);
+		benchWait(client, 800);
+	}
+}
+
+static void benchBrightness(ledclient_T* client)
+{
+	unsigned char rgb[BENCH_LEDS * 3];
+	unsigned int n;
+
+	benchPattern(rgb, 77);
+	ledclientFrame(client, 0, rgb, BENCH_LEDS);
+	for(n=0;n<256;n++)
+		ledclientBrightness(client, 255 - n);
+	ledclientFlush(client);
+}
+
+static const bench_scenario_T bench_scenarios[] =
+{
+	{ "color",			benchColor,			501,	0x663E001CUL },
+	{ "frame",			benchFrame,			501,	0xB0AC9374UL },
+	{ "frame-framed",	benchFramed,		501,	0xB0AC9374UL },
+	{ "framed-drop",	benchFramedDrop,	502,	0xC5A12245UL },
+	{ "rle",			benchRle,			501,	0xF8B4EAD3UL },
+	{ "partial",		benchPartial,		501,	0xCC6A93CEUL },
+	{ "palette",		benchPalette,		501,	0x4C146068UL },
+	{ "fill",			benchFill,			501,	0xCD0875AFUL },
+	{ "sweep",			benchSweep,			2003,	0xABB2FC87UL },
+	{ "sweep-eased",	benchSweepEased,	3121,	0x820CF8CDUL },
+	{ "gradient",		benchGradient,		1001,	0x74568B38UL },
+	{ "effects",		benchEffects,		1005,	0x1EF1C734UL },
+	{ "crossfade",		benchCrossfade,		801,	0x66FB0FE6UL },
+	{ "fade-color",		benchFadeColor,		421,	0x8A6913C3UL },
+	{ "brightness",		benchBrightness,	258,	0x95DCB423UL },
+};
+
+#define BENCH_SCENARIOS				(sizeof(bench_scenarios) / sizeof(bench_scenarios[0]))
+
+static double benchSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Run one scenario on a fresh firmware, returns 0 if it matched the golden output
+static int benchRun(const bench_scenario_T* scenario, int check)
+{
+	ledclient_T client;
+	loopback_counters_T before, after;
+	unsigned long frames, per;
+	double start, seconds;
+	int ok;
+
+	ledclientOpenLoopback(&client, BENCH_BYTE_US);
+	loopbackCounters(&before);
+	start = benchSeconds();
+	scenario->run(&client);
+	seconds = benchSeconds() - start;
+	loopbackCounters(&after);
+
+	frames = after.frames - before.frames;
+	per = frames ? frames : 1;
+	ok = frames == scenario->frames && after.hash == scenario->hash;
+	printf("%-14s %6lu %9.1f %9.1f %7.1f %9.0f  %08lX%s\n", scenario->name, frames,
+		(double)(after.bytes - before.bytes) / per, (double)(after.polls - before.polls) / per,
+		(double)(after.leds - before.leds) / per, seconds * 1e9 / per, after.hash,
+		!check ? "" : ok ? "  ok" : "  DIFFERS");
+	if (client.stats.failed)
+		printf("%-14s %lu commands failed\n", "", client.stats.failed);
+	return check && !ok;
+}
+
+int main(int argc, char** argv)
+{
+	int check = argc > 1 && !strcmp(argv[1], "-c");
+	int failed = 0;
+	int status;
+	unsigned int i;
+
+	printf("%-14s %6s %9s %9s %7s %9s  %s\n", "scenario", "frames", "bytes/f", "polls/f", "leds/f", "ns/f", "hash");
+	fflush(stdout);
+	for(i=0;i<BENCH_SCENARIOS;i++)
+	{
+		// the firmware is global state, every scenario gets a fresh one
+		if (fork() == 0)
+		{
+			status = benchRun(&bench_scenarios[i], check);
+			fflush(stdout);
+			_exit(status);
+		}
+		wait(&status);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			failed++;
+	}
+	if (check)
+		printf(failed ? "%d scenarios differ\n" : "all scenarios match\n", failed);
+	return failed ? 1 : 0;
+}
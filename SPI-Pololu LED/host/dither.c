@@ -0,0 +1,87 @@
+//*****************************************************************************
+// File Name	: dither.c
+// Title		: Check of the LED_STRIP_DITHER arithmetic
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+// Runs every color byte through led_strip_dither() (ledstripdither.h)
+// without the gamma table, refresh after refresh, for a few brightnesses.
+// At full brightness every byte has to be sent as it is on every refresh,
+// scaled ones have to stay within one step of the exact level on every
+// refresh and average out to it. Anything else is reported and the exit
+// code is 1.
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdio.h>
+#include "ledstripdither.h"
+
+//----- Defines ---------------------------------------------------------------
+#define DITHER_REFRESHES			256			// refreshes per color byte
+
+//----- Global Variables -------------------------------------------------------
+static const unsigned char dither_brightness[] = { 255, 200, 127, 31, 0 };
+
+#define DITHER_BRIGHTNESSES			(sizeof(dither_brightness) / sizeof(dither_brightness[0]))
+
+//----- Functions --------------------------------------------------------------
+
+// all color bytes at one brightness, returns the number of bytes that failed
+static int ditherCheck(unsigned char brightness)
+{
+	unsigned int scale = brightness + 1;
+	unsigned int value, n, changes;
+	unsigned char residue, out, last;
+	double exact, error, mean, worst = 0, drift = 0;
+	int failed = 0, bad;
+
+	for(value=0;value<256;value++)
+	{
+		exact = value * scale / 256.0;
+		residue = 0;
+		last = 0;
+		changes = 0;
+		mean = 0;
+		bad = 0;
+		for(n=0;n<DITHER_REFRESHES;n++)
+		{
+			out = led_strip_dither(LED_STRIP_DITHER_LINEAR(value), scale, &residue);
+			error = out > exact ? out - exact : exact - out;
+			if (error > worst)
+				worst = error;
+			if (error >= 1)
+				bad = 1;
+			if (n && out != last)
+				changes++;
+			last = out;
+			mean += out;
+		}
+		mean /= DITHER_REFRESHES;
+		error = mean > exact ? mean - exact : exact - mean;
+		if (error > drift)
+			drift = error;
+
+		// a plain color at full brightness is sent unchanged, a scaled one averages out
+		if (scale == 256 ? out != value || changes || residue : bad || error > 0.125)
+		{
+			printf("brightness %3u  value %3u  sent %3u  changes %3u  mean %7.3f of %7.3f  wrong\n",
+				brightness, value, out, changes, mean, exact);
+			failed++;
+		}
+	}
+	printf("brightness %3u  worst step %5.3f  worst mean %5.3f  %s\n", brightness, worst, drift,
+		failed ? "wrong" : "ok");
+	return failed;
+}
+
+int main(void)
+{
+	unsigned int i;
+	int failed = 0;
+
+	for(i=0;i<DITHER_BRIGHTNESSES;i++)
+		failed += ditherCheck(dither_brightness[i]);
+	if (failed)
+		printf("%d color bytes wrong\n", failed);
+	return failed ? 1 : 0;
+}
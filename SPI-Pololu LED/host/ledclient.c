@@ -0,0 +1,426 @@
+//*****************************************************************************
+// File Name	: ledclient.c
+// Title		: Host client for the SPI-Pololu LED controller
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include "crc8.h"
+#include "ledclient.h"
+
+//----- Defines ---------------------------------------------------------------
+#define LEDCLIENT_SYNC				0x7E		// LINK_SYNC of the firmware
+#define LEDCLIENT_STATUS_SIZE		21			// sizeof(status_T) on the controller
+#define LEDCLIENT_SPI_CHUNK			256			// spi_ioc_transfer entries per ioctl
+
+//----- Typedefs --------------------------------------------------------------
+typedef struct ledclient_spidev_S
+{
+	int fd;
+	unsigned long hz;
+	unsigned int byte_gap_us;
+} ledclient_spidev_T;
+
+//----- Functions --------------------------------------------------------------
+
+// Every byte is its own transfer so the controller gets its gap after each,
+// all of them go in one ioctl with chip select held
+static int ledclientSpiTransfer(void* ctx, const unsigned char* tx, unsigned char* rx, unsigned int len)
+{
+	ledclient_spidev_T* spi = ctx;
+	struct spi_ioc_transfer xfer[LEDCLIENT_SPI_CHUNK];
+	unsigned int i, n;
+
+	while (len)
+	{
+		n = len < LEDCLIENT_SPI_CHUNK ? len : LEDCLIENT_SPI_CHUNK;
+		memset(xfer, 0, n * sizeof(xfer[0]));
+		for(i=0;i<n;i++)
+		{
+			xfer[i].tx_buf = (unsigned long)&tx[i];
+			xfer[i].rx_buf = (unsigned long)&rx[i];
+			xfer[i].len = 1;
+			xfer[i].speed_hz = spi->hz;
+			xfer[i].delay_usecs = spi->byte_gap_us;
+			xfer[i].bits_per_word = 8;
+		}
+		if (ioctl(spi->fd, SPI_IOC_MESSAGE(n), xfer) < 0)
+			return -1;
+		tx += n;
+		rx += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static void ledclientSpiIdle(void* ctx, unsigned int us)
+{
+	(void)ctx;
+	usleep(us);
+}
+
+static void ledclientSpiClose(void* ctx)
+{
+	ledclient_spidev_T* spi = ctx;
+
+	close(spi->fd);
+	free(spi);
+}
+
+void ledclientOpen(ledclient_T* client, const ledclient_backend_T* backend)
+{
+	client->backend = *backend;
+	client->framed = 0;
+	client->seq = 0;
+	client->depth = 0;
+	client->len = 0;
+	client->commands = 0;
+	memset(&client->stats, 0, sizeof(client->stats));
+}
+
+int ledclientOpenSpi(ledclient_T* client, const char* device, unsigned long hz, unsigned int byte_gap_us)
+{
+	ledclient_backend_T backend;
+	ledclient_spidev_T* spi;
+	unsigned char mode = SPI_MODE_0;
+	unsigned char bits = 8;
+	unsigned int speed = hz;
+
+	spi = malloc(sizeof(*spi));
+	if (!spi)
+		return -1;
+	spi->fd = open(device, O_RDWR);
+	if (spi->fd < 0)
+	{
+		free(spi);
+		return -1;
+	}
+	if (ioctl(spi->fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+		ioctl(spi->fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+		ioctl(spi->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+	{
+		int err = errno;
+		close(spi->fd);
+		free(spi);
+		errno = err;
+		return -1;
+	}
+	spi->hz = hz;
+	spi->byte_gap_us = byte_gap_us;
+
+	backend.transfer = ledclientSpiTransfer;
+	backend.idle = ledclientSpiIdle;
+	backend.close = ledclientSpiClose;
+	backend.ctx = spi;
+	ledclientOpen(client, &backend);
+	return 0;
+}
+
+void ledclientClose(ledclient_T* client)
+{
+	ledclientFlush(client);
+	client->backend.close(client->backend.ctx);
+}
+
+void ledclientFramed(ledclient_T* client, unsigned char on)
+{
+	ledclientFlush(client);
+	client->framed = on;
+	client->seq = 0;
+}
+
+int ledclientSend(ledclient_T* client, const unsigned char* command, unsigned int len)
+{
+	unsigned int need = client->framed ? len + 4 : len;
+	unsigned char* p;
+	unsigned char crc = 0;
+	unsigned int i;
+
+	if (need > LEDCLIENT_BATCH || (client->framed && len > 255))
+	{
+		errno = EMSGSIZE;
+		return -1;
+	}
+	if (client->len + need > LEDCLIENT_BATCH || client->commands == LEDCLIENT_COMMANDS)
+	{
+		if (ledclientFlush(client) < 0)
+			return -1;
+	}
+
+	p = &client->tx[client->len];
+	if (client->framed)
+	{
+		*p++ = LEDCLIENT_SYNC;
+		*p++ = len;
+		*p++ = client->seq;
+		crc = crc8Update(crc, len);
+		crc = crc8Update(crc, client->seq);
+		for(i=0;i<len;i++)
+			crc = crc8Update(crc, command[i]);
+		// 0 only starts the count
+		client->seq = client->seq == 255 ? 1 : client->seq + 1;
+	}
+	memcpy(p, command, len);
+	p += len;
+	if (client->framed)
+		*p = crc;
+
+	client->len += need;
+	client->end[client->commands] = client->len;
+	client->tries[client->commands] = 0;
+	client->commands++;
+	return 0;
+}
+
+// Number the framed commands in tx again from 0, which the controller always
+// runs; after one was given up it would otherwise wait for that one forever
+static void ledclientRestart(ledclient_T* client)
+{
+	unsigned int i, j, start;
+	unsigned char* p;
+	unsigned char crc;
+
+	client->seq = 0;
+	start = 0;
+	for(i=0;i<client->commands;i++)
+	{
+		p = &client->tx[start];
+		p[2] = client->seq;
+		crc = crc8Update(0, p[1]);
+		crc = crc8Update(crc, p[2]);
+		for(j=0;j<p[1];j++)
+			crc = crc8Update(crc, p[3 + j]);
+		p[3 + p[1]] = crc;
+		client->seq = client->seq == 255 ? 1 : client->seq + 1;
+		start = client->end[i];
+	}
+}
+
+int ledclientFlush(ledclient_T* client)
+{
+	unsigned int i, start, keep, kept, ran;
+	unsigned char reply;
+	unsigned char resync, gaveup;
+	int result = 0;
+
+	while (client->commands)
+	{
+		// let a full queue drain first
+		if (client->depth >= LEDCLIENT_QUEUE - 1)
+		{
+			client->backend.idle(client->backend.ctx, LEDCLIENT_DRAIN_US);
+			client->depth = 0;
+		}
+
+		// the filler clocks in the reply to the last command
+		client->tx[client->len] = 0;
+		if (client->backend.transfer(client->backend.ctx, client->tx, client->rx, client->len + 1) < 0)
+		{
+			client->stats.failed += client->commands;
+			client->len = 0;
+			client->commands = 0;
+			return -1;
+		}
+		client->stats.transfers++;
+		client->stats.bytes += client->len + 1;
+
+		// unframed commands after a failed one run anyway, so a failed one
+		// is only sent again if nothing behind it ran, or the order changes
+		ran = 0;
+		if (!client->framed)
+		{
+			for(i=0;i<client->commands;i++)
+				if ((client->rx[client->end[i]] & 0xF0) == LEDCLIENT_ACK_DEPTH)
+					ran = i + 1;
+		}
+
+		// move the commands that have to go again to the front
+		start = 0;
+		keep = 0;
+		kept = 0;
+		resync = 0;
+		gaveup = 0;
+		for(i=0;i<client->commands;i++)
+		{
+			reply = client->rx[client->end[i]];
+			if ((reply & 0xF0) == LEDCLIENT_ACK_DEPTH)
+			{
+				client->stats.sent++;
+				client->depth = reply & 0x0F;
+			}
+			else
+			{
+				if (reply == LEDCLIENT_ACK_DROPPED)
+				{
+					client->stats.dropped++;
+					client->depth = LEDCLIENT_QUEUE;
+				}
+				else if ((reply & 0xF0) == LEDCLIENT_NAK)
+				{
+					client->stats.rejected++;
+				}
+				else
+				{
+					// out of step, wait until the controller drops what it has
+					client->stats.lost++;
+					resync = 1;
+				}
+
+				if (i < ran || ++client->tries[i] >= LEDCLIENT_RETRIES)
+				{
+					client->stats.failed++;
+					result = -1;
+					gaveup = 1;
+				}
+				else
+				{
+					memmove(&client->tx[kept], &client->tx[start], client->end[i] - start);
+					kept += client->end[i] - start;
+					client->end[keep] = kept;
+					client->tries[keep] = client->tries[i];
+					keep++;
+				}
+			}
+			start = client->end[i];
+		}
+		client->len = kept;
+		client->commands = keep;
+		if (gaveup && client->framed)
+			ledclientRestart(client);
+
+		if (resync)
+			client->backend.idle(client->backend.ctx, LEDCLIENT_RESYNC_US);
+	}
+	return result;
+}
+
+int ledclientIdle(ledclient_T* client, unsigned int us)
+{
+	int result = ledclientFlush(client);
+
+	client->backend.idle(client->backend.ctx, us);
+	return result;
+}
+
+static int ledclientSend4(ledclient_T* client, unsigned char cmd, unsigned char a, unsigned char b, unsigned char c, unsigned char d)
+{
+	unsigned char command[5] = { cmd, a, b, c, d };
+
+	return ledclientSend(client, command, sizeof(command));
+}
+
+int ledclientColor(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'c', r, g, b, 0);
+}
+
+int ledclientExecute(ledclient_T* client)
+{
+	return ledclientSend4(client, 'E', 0, 0, 0, 0);
+}
+
+int ledclientLow(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'l', r, g, b, 0);
+}
+
+int ledclientHigh(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'h', r, g, b, 0);
+}
+
+int ledclientSweep(ledclient_T* client, unsigned char time, unsigned short mult, unsigned short divider, unsigned char easing)
+{
+	// the firmware adds one to both
+	return ledclientSend4(client, 'S', time, mult - 1, divider - 1, easing);
+}
+
+int ledclientStop(ledclient_T* client, unsigned char index, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'M', index, r, g, b);
+}
+
+int ledclientBrightness(ledclient_T* client, unsigned char brightness)
+{
+	return ledclientSend4(client, 'B', brightness, 0, 0, 0);
+}
+
+int ledclientCrossfade(ledclient_T* client, unsigned short ms, unsigned char now)
+{
+	return ledclientSend4(client, 'X', ms >> 8, ms & 0xFF, now, 0);
+}
+
+int ledclientFadeColor(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'C', r, g, b, 0);
+}
+
+int ledclientRender(ledclient_T* client, unsigned char mode, unsigned char step, unsigned char speed)
+{
+	return ledclientSend4(client, 'R', mode, step, speed, 0);
+}
+
+int ledclientSegment(ledclient_T* client, unsigned char length, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'G', length, r, g, b);
+}
+
+int ledclientEffect(ledclient_T* client, unsigned char effect, unsigned char speed, unsigned char size)
+{
+	return ledclientSend4(client, 'A', effect, speed, size, 0);
+}
+
+int ledclientPalette(ledclient_T* client, unsigned char index, unsigned char r, unsigned char g, unsigned char b)
+{
+	return ledclientSend4(client, 'p', index, r, g, b);
+}
+
+int ledclientFrame(ledclient_T* client, unsigned char start, const unsigned char* rgb, unsigned char count)
+{
+	unsigned char command[3 + 255 * 3];
+
+	command[0] = 'F';
+	command[1] = start;
+	command[2] = count;
+	memcpy(&command[3], rgb, count * 3);
+	return ledclientSend(client, command, 3 + count * 3);
+}
+
+int ledclientStatus(ledclient_T* client, ledclient_status_T* status)
+{
+	unsigned char tx[1 + LEDCLIENT_STATUS_SIZE];
+	unsigned char rx[1 + LEDCLIENT_STATUS_SIZE];
+	const unsigned char* p = &rx[1];
+
+	if (ledclientFlush(client) < 0)
+		return -1;
+
+	// the snapshot comes out during the fillers
+	memset(tx, 0, sizeof(tx));
+	tx[0] = 'Q';
+	if (client->backend.transfer(client->backend.ctx, tx, rx, sizeof(tx)) < 0)
+		return -1;
+	client->stats.transfers++;
+	client->stats.bytes += sizeof(tx);
+
+	status->frames = p[0] | (p[1] << 8);
+	status->commands = p[2] | (p[3] << 8);
+	status->dropped = p[4] | (p[5] << 8);
+	status->resyncs = p[6] | (p[7] << 8);
+	status->rejects = p[8] | (p[9] << 8);
+	status->write_cycles = p[10] | (p[11] << 8) | ((unsigned long)p[12] << 16) | ((unsigned long)p[13] << 24);
+	status->state = p[14];
+	status->queued = p[15];
+	memcpy(status->sweep_colour, &p[16], 3);
+	status->free_ram = p[19] | (p[20] << 8);
+	return 0;
+}
@@ -0,0 +1,159 @@
+//*****************************************************************************
+// File Name	: ledclient.h
+// Title		: Host client for the SPI-Pololu LED controller
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+// Commands are collected in a batch and go out in one SPI transfer when
+// ledclientFlush() is called or the batch is full, so a frame and the
+// commands around it cost one system call. The reply byte after the last
+// byte of every command is checked: a command the controller dropped on a
+// full queue, or a framed command it rejected, is sent again; framed ones
+// in their original order, see controller.c. A framed command given up
+// after LEDCLIENT_RETRIES would leave a gap the controller never gets past,
+// so the ones after it are numbered again from 0, which always runs. An
+// unframed command is only sent again if none after it in the batch ran,
+// otherwise it is given up rather than run out of order. The queue depth in
+// the replies paces the batches, so the controller's queue is not overrun
+// in the first place.
+//
+// Two backends carry the bytes: spidev for the real controller and a
+// loopback that runs the firmware itself on the host (loopback.h).
+//*****************************************************************************
+
+#ifndef ledclient_h
+#define ledclient_h
+
+//----- Defines ---------------------------------------------------------------
+#define LEDCLIENT_BATCH				512			// bytes per transfer
+#define LEDCLIENT_COMMANDS			128			// commands per transfer
+#define LEDCLIENT_QUEUE				8			// CMDQUEUE_SIZE of the firmware
+#define LEDCLIENT_RETRIES			4			// transfers before a command is given up
+#define LEDCLIENT_RESYNC_US			2500		// longer than SPI_RESYNC_US of the firmware
+#define LEDCLIENT_DRAIN_US			1000		// wait for a full queue to drain
+
+// reply after the last byte of a command, see controller.c
+#define LEDCLIENT_ACK_DEPTH			0xE0
+#define LEDCLIENT_ACK_DROPPED		0xFF
+#define LEDCLIENT_NAK				0xF0
+
+//----- Typedefs --------------------------------------------------------------
+
+// how the bytes reach the controller
+typedef struct ledclient_backend_S
+{
+	// full duplex transfer, rx[i] is clocked in while tx[i] goes out
+	int (*transfer)(void* ctx, const unsigned char* tx, unsigned char* rx, unsigned int len);
+	// give the controller us microseconds without traffic
+	void (*idle)(void* ctx, unsigned int us);
+	void (*close)(void* ctx);
+	void* ctx;
+} ledclient_backend_T;
+
+// counters since ledclientOpen...(), in commands
+typedef struct ledclient_stats_S
+{
+	unsigned long sent;				// commands acked by the controller
+	unsigned long transfers;		// SPI transfers
+	unsigned long bytes;			// bytes transferred, retries included
+	unsigned long dropped;			// commands the controller lost on a full queue
+	unsigned long rejected;			// framed commands that failed the crc or length check
+	unsigned long lost;				// commands answered with something unexpected
+	unsigned long failed;			// commands given up after LEDCLIENT_RETRIES or out of order
+} ledclient_stats_T;
+
+// status snapshot read with 'Q', status_T of controller.c
+typedef struct ledclient_status_S
+{
+	unsigned short frames;
+	unsigned short commands;
+	unsigned short dropped;
+	unsigned short resyncs;
+	unsigned short rejects;
+	unsigned long write_cycles;
+	unsigned char state;
+	unsigned char queued;
+	unsigned char sweep_colour[3];
+	unsigned short free_ram;
+} ledclient_status_T;
+
+typedef struct ledclient_S
+{
+	ledclient_backend_T backend;
+	unsigned char framed;			// send commands framed with sequence number and crc
+	unsigned char seq;				// sequence number of the next framed command
+	unsigned char depth;			// queue depth in the last reply
+	unsigned char tx[LEDCLIENT_BATCH + 1];
+	unsigned char rx[LEDCLIENT_BATCH + 1];
+	unsigned int len;				// bytes in tx
+	unsigned int end[LEDCLIENT_COMMANDS];	// end of each command in tx
+	unsigned char tries[LEDCLIENT_COMMANDS];
+	unsigned int commands;			// commands in tx
+	ledclient_stats_T stats;
+} ledclient_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// ledclientOpen()
+//     starts a client on any backend, the ones below call it
+void ledclientOpen(ledclient_T* client, const ledclient_backend_T* backend);
+
+// ledclientOpenSpi()
+//     opens a spidev device, e.g. "/dev/spidev0.0", at hz with byte_gap_us
+//     between bytes, the controller needs about 70 us per byte, see ledstrip.h
+//     returns 0 or -1 with errno set
+int ledclientOpenSpi(ledclient_T* client, const char* device, unsigned long hz, unsigned int byte_gap_us);
+
+// ledclientOpenLoopback()
+//     runs the firmware on the host instead, see loopback.h
+//     byte_us is the simulated time per SPI byte
+int ledclientOpenLoopback(ledclient_T* client, unsigned int byte_us);
+
+// ledclientClose()
+//     flushes and closes the backend
+void ledclientClose(ledclient_T* client);
+
+// ledclientFramed()
+//     flushes and sends the following commands framed (sync, length,
+//     sequence, crc), starting the sequence count again
+void ledclientFramed(ledclient_T* client, unsigned char on);
+
+// ledclientSend()
+//     adds one command of len bytes to the batch, flushing first if it
+//     does not fit, returns 0 or -1 if a flush failed
+int ledclientSend(ledclient_T* client, const unsigned char* command, unsigned int len);
+
+// ledclientFlush()
+//     sends the batch, repeats dropped and rejected commands as long as
+//     that keeps them in order
+//     returns 0 or -1 if a command was given up or the backend failed
+int ledclientFlush(ledclient_T* client);
+
+// ledclientIdle()
+//     flushes and leaves the link quiet for us microseconds
+int ledclientIdle(ledclient_T* client, unsigned int us);
+
+// Commands, see controller.c for what they do
+int ledclientColor(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b);
+int ledclientExecute(ledclient_T* client);
+int ledclientLow(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b);
+int ledclientHigh(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b);
+int ledclientSweep(ledclient_T* client, unsigned char time, unsigned short mult, unsigned short divider, unsigned char easing);
+int ledclientStop(ledclient_T* client, unsigned char index, unsigned char r, unsigned char g, unsigned char b);
+int ledclientBrightness(ledclient_T* client, unsigned char brightness);
+int ledclientCrossfade(ledclient_T* client, unsigned short ms, unsigned char now);
+int ledclientFadeColor(ledclient_T* client, unsigned char r, unsigned char g, unsigned char b);
+int ledclientRender(ledclient_T* client, unsigned char mode, unsigned char step, unsigned char speed);
+int ledclientSegment(ledclient_T* client, unsigned char length, unsigned char r, unsigned char g, unsigned char b);
+int ledclientEffect(ledclient_T* client, unsigned char effect, unsigned char speed, unsigned char size);
+int ledclientPalette(ledclient_T* client, unsigned char index, unsigned char r, unsigned char g, unsigned char b);
+
+// ledclientFrame()
+//     uploads count red, green, blue triplets from LED start with 'F'
+int ledclientFrame(ledclient_T* client, unsigned char start, const unsigned char* rgb, unsigned char count);
+
+// ledclientStatus()
+//     flushes and reads the status snapshot, returns 0 or -1
+int ledclientStatus(ledclient_T* client, ledclient_status_T* status);
+
+#endif
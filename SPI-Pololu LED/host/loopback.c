@@ -0,0 +1,238 @@
+//*****************************************************************************
+// File Name	: loopback.c
+// Title		: The controller firmware running on the host
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "hal.h"
+#include "ledstrip.h"
+#include "systime.h"
+#include "tick.h"
+#include "controller.h"
+#include "ledclient.h"
+#include "loopback.h"
+
+//----- Defines ---------------------------------------------------------------
+#define LOOPBACK_FNV_OFFSET			2166136261UL
+#define LOOPBACK_FNV_PRIME			16777619UL
+
+//----- Global Variables -------------------------------------------------------
+static unsigned char loopback_started = 0;
+static unsigned long loopback_us = 0;		// simulated time
+static unsigned long loopback_ms = 0;		// ticks delivered
+static unsigned int loopback_byte_us;
+static unsigned char loopback_out;			// byte the controller shifts out next
+
+static rgb_color loopback_strip[LOOPBACK_LEDS];
+static unsigned int loopback_count = 0;
+static unsigned int loopback_level = 256;	// brightness + 1
+static loopback_counters_T loopback_counters = { 0, 0, 0, 0, LOOPBACK_FNV_OFFSET };
+
+//----- Functions --------------------------------------------------------------
+
+// systime.h on the simulated clock
+void systimeInit(void)
+{
+}
+
+unsigned long systimeCycles(void)
+{
+	return loopback_us * (F_CPU / 1000000);
+}
+
+unsigned short systimeMs(void)
+{
+	return loopback_us / 1000;
+}
+
+unsigned long systimeSeconds(void)
+{
+	return loopback_us / 1000000;
+}
+
+// tick.h on the simulated clock, without the status LEDs
+void tickInit(void)
+{
+}
+
+unsigned short tickNow(void)
+{
+	return loopback_ms * TICK_HZ / 1000;
+}
+
+unsigned char tickDue(unsigned short* deadline, unsigned short period)
+{
+	unsigned short now = tickNow();
+
+	if ((short)(now - *deadline) < 0)
+		return 0;
+
+	*deadline += period;
+	if ((short)(now - *deadline) >= 0)
+		*deadline = now + period;
+	return 1;
+}
+
+void tickLed(unsigned char led, unsigned short on, unsigned short off)
+{
+	(void)led;
+	(void)on;
+	(void)off;
+}
+
+// the host's memory says nothing about the controller's
+unsigned short halFreeRam(void)
+{
+	return 0;
+}
+
+// ledstrip.h keeping the frame
+void led_strip_brightness(unsigned char brightness)
+{
+	loopback_level = brightness + 1;
+}
+
+static unsigned long loopbackHash(unsigned long hash, unsigned char byte)
+{
+	return ((hash ^ byte) * LOOPBACK_FNV_PRIME) & 0xFFFFFFFFUL;
+}
+
+void led_strip_generate(led_strip_generator next, unsigned int count)
+{
+	unsigned long hash = loopback_counters.hash;
+	unsigned int i;
+	rgb_color color;
+
+	for(i=0;i<count;i++)
+	{
+		next(&color);
+		color.red = (color.red * loopback_level) >> 8;
+		color.green = (color.green * loopback_level) >> 8;
+		color.blue = (color.blue * loopback_level) >> 8;
+		if (i < LOOPBACK_LEDS)
+			loopback_strip[i] = color;
+		hash = loopbackHash(hash, color.red);
+		hash = loopbackHash(hash, color.green);
+		hash = loopbackHash(hash, color.blue);
+	}
+	loopback_count = count;
+	loopback_counters.hash = hash;
+	loopback_counters.frames++;
+	loopback_counters.leds += count;
+}
+
+static rgb_color* loopback_write;
+
+static void loopbackWriteNext(rgb_color* color)
+{
+	*color = *loopback_write++;
+}
+
+void led_strip_write(rgb_color* colors, unsigned int count)
+{
+	loopback_write = colors;
+	led_strip_generate(loopbackWriteNext, count);
+}
+
+void led_strip_start(rgb_color* colors, unsigned int count)
+{
+	led_strip_write(colors, count);
+}
+
+unsigned char led_strip_busy(void)
+{
+	return 0;
+}
+
+void loopbackRun(unsigned long us)
+{
+	loopback_us += us;
+	while (loopback_ms < loopback_us / 1000)
+	{
+		loopback_ms++;
+		controllerPoll();
+		loopback_counters.polls++;
+	}
+}
+
+unsigned long loopbackNow(void)
+{
+	return loopback_us;
+}
+
+unsigned int loopbackStrip(unsigned char* rgb, unsigned int max)
+{
+	unsigned int i;
+
+	for(i=0;i<max && i<loopback_count && i<LOOPBACK_LEDS;i++)
+	{
+		*rgb++ = loopback_strip[i].red;
+		*rgb++ = loopback_strip[i].green;
+		*rgb++ = loopback_strip[i].blue;
+	}
+	return loopback_count;
+}
+
+unsigned long loopbackFrames(void)
+{
+	return loopback_counters.frames;
+}
+
+void loopbackCounters(loopback_counters_T* counters)
+{
+	*counters = loopback_counters;
+}
+
+// One byte each: shift out what the controller loaded, hand it the byte and give
+// the main loop a pass before the next one
+static int loopbackTransfer(void* ctx, const unsigned char* tx, unsigned char* rx, unsigned int len)
+{
+	unsigned int i;
+
+	(void)ctx;
+	for(i=0;i<len;i++)
+	{
+		rx[i] = loopback_out;
+		loopback_out = controllerSpiByte(tx[i]);
+		loopback_counters.bytes++;
+		loopbackRun(loopback_byte_us);
+		controllerPoll();
+		loopback_counters.polls++;
+	}
+	return 0;
+}
+
+static void loopbackIdle(void* ctx, unsigned int us)
+{
+	(void)ctx;
+	loopbackRun(us);
+	controllerPoll();
+	loopback_counters.polls++;
+}
+
+static void loopbackClose(void* ctx)
+{
+	(void)ctx;
+}
+
+int ledclientOpenLoopback(ledclient_T* client, unsigned int byte_us)
+{
+	ledclient_backend_T backend;
+
+	backend.transfer = loopbackTransfer;
+	backend.idle = loopbackIdle;
+	backend.close = loopbackClose;
+	backend.ctx = 0;
+	ledclientOpen(client, &backend);
+	loopback_byte_us = byte_us;
+
+	if (!loopback_started)
+	{
+		controllerInit();
+		loopback_started = 1;
+	}
+	return 0;
+}
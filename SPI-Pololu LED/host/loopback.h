@@ -0,0 +1,59 @@
+//*****************************************************************************
+// File Name	: loopback.h
+// Title		: The controller firmware running on the host
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+// controller.c and the render, sweep, fade, command queue and crc modules
+// are built for the host with HAL_HOST (hal.h), this file stands in for the
+// strip, clock and tick drivers. Each byte of a transfer goes through
+// controllerSpiByte() and one pass of the main loop, on a simulated clock
+// that advances by the byte time, so a run is the same every time and as
+// fast as the host. What would go to the strip is kept here instead. The
+// firmware is global state, there is one loopback per process.
+//*****************************************************************************
+
+#ifndef loopback_h
+#define loopback_h
+
+//----- Defines ---------------------------------------------------------------
+#define LOOPBACK_LEDS				256			// most LEDs kept of a frame
+
+//----- Typedefs --------------------------------------------------------------
+
+// work done by the firmware since it started
+typedef struct loopback_counters_S
+{
+	unsigned long bytes;			// controllerSpiByte() calls
+	unsigned long polls;			// controllerPoll() calls
+	unsigned long frames;			// frames sent to the strip
+	unsigned long leds;				// LEDs sent to the strip
+	unsigned long hash;				// FNV-1a of every LED sent, in order
+} loopback_counters_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// loopbackRun()
+//     advances the simulated clock by us, the tick and the main loop run
+//     once per simulated millisecond
+void loopbackRun(unsigned long us);
+
+// loopbackNow()
+//     returns the simulated time in microseconds since the firmware started
+unsigned long loopbackNow(void);
+
+// loopbackStrip()
+//     copies up to max red, green, blue triplets of the last frame to rgb,
+//     with the brightness applied but not the gamma table, returns the
+//     number of LEDs in the frame
+unsigned int loopbackStrip(unsigned char* rgb, unsigned int max);
+
+// loopbackFrames()
+//     returns the number of frames sent to the strip
+unsigned long loopbackFrames(void);
+
+// loopbackCounters()
+//     copies the counters, the hash identifies everything shown so far
+void loopbackCounters(loopback_counters_T* counters);
+
+#endif
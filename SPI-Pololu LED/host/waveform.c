@@ -0,0 +1,315 @@
+//*****************************************************************************
+// File Name	: waveform.c
+// Title		: Simulated waveform check of the strip bit timing
+// Target MCU	: Linux host
+// Editor Tabs	: 4
+//
+// For every chip profile of ledstripchip.h and a list of crystals, takes the
+// nop counts and USART rate ledstrip.c would build with, steps through the
+// bit-banged, the LED_STRIP_PARALLEL and the LED_STRIP_USART slot cycle by
+// cycle and records the edges on the data line. The pulses are decoded back into bytes and
+// measured against the high times and tolerance of the profile, and the low times and the
+// slot against its minimums.
+//
+// A clock the build refuses (#error in ledstrip.c) has to miss the timing
+// in the simulation too, and one it accepts has to meet it and send the
+// right bytes; anything else is reported and the exit code is 1.
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "ledstrip.h"
+
+//----- Defines ---------------------------------------------------------------
+#define WAVEFORM_BYTES				64			// bytes sent per run
+#define WAVEFORM_EDGES				(WAVEFORM_BYTES * 8 * 2)
+
+//----- Typedefs --------------------------------------------------------------
+typedef struct waveform_chip_S
+{
+	const char* name;
+	unsigned long t0h, t1h, slot, tol;
+	unsigned long t0l, t1l, min;	// shortest low times and slot
+} waveform_chip_T;
+
+typedef struct waveform_S
+{
+	unsigned long cycle;			// cycles since the start
+	unsigned char carry;
+	unsigned int edges;
+	unsigned long edge[WAVEFORM_EDGES];	// cycles of the rising and falling edges
+} waveform_T;
+
+//----- Global Variables -------------------------------------------------------
+static const waveform_chip_T waveform_chips[] =
+{
+	{ "pololu",	LED_STRIP_POLOLU_T0H_NS, LED_STRIP_POLOLU_T1H_NS, LED_STRIP_POLOLU_SLOT_NS, LED_STRIP_POLOLU_TOL_NS,
+		LED_STRIP_POLOLU_T0L_MIN_NS, LED_STRIP_POLOLU_T1L_MIN_NS, LED_STRIP_POLOLU_SLOT_MIN_NS },
+	{ "ws2812",	LED_STRIP_WS2812_T0H_NS, LED_STRIP_WS2812_T1H_NS, LED_STRIP_WS2812_SLOT_NS, LED_STRIP_WS2812_TOL_NS,
+		LED_STRIP_WS2812_T0L_MIN_NS, LED_STRIP_WS2812_T1L_MIN_NS, LED_STRIP_WS2812_SLOT_MIN_NS },
+	{ "ws2811",	LED_STRIP_WS2811_T0H_NS, LED_STRIP_WS2811_T1H_NS, LED_STRIP_WS2811_SLOT_NS, LED_STRIP_WS2811_TOL_NS,
+		LED_STRIP_WS2811_T0L_MIN_NS, LED_STRIP_WS2811_T1L_MIN_NS, LED_STRIP_WS2811_SLOT_MIN_NS },
+	{ "sk6812",	LED_STRIP_SK6812_T0H_NS, LED_STRIP_SK6812_T1H_NS, LED_STRIP_SK6812_SLOT_NS, LED_STRIP_SK6812_TOL_NS,
+		LED_STRIP_SK6812_T0L_MIN_NS, LED_STRIP_SK6812_T1L_MIN_NS, LED_STRIP_SK6812_SLOT_MIN_NS },
+};
+
+static const unsigned long waveform_clocks[] =
+{
+	3686400, 7372800, 8000000, 11059200, 12000000, 14745600, 16000000, 18432000, 20000000
+};
+
+#define WAVEFORM_CHIPS				(sizeof(waveform_chips) / sizeof(waveform_chips[0]))
+#define WAVEFORM_CLOCKS				(sizeof(waveform_clocks) / sizeof(waveform_clocks[0]))
+
+//----- Functions --------------------------------------------------------------
+
+static void waveformRun(waveform_T* w, unsigned int cycles)
+{
+	w->cycle += cycles;
+}
+
+// the pin changes when the instruction driving it completes
+static void waveformEdge(waveform_T* w, unsigned int cycles)
+{
+	waveformRun(w, cycles);
+	w->edge[w->edges++] = w->cycle;
+}
+
+// led_strip_output() without LED_STRIP_PARALLEL, one LED of count bytes
+static void waveformBitBang(waveform_T* w, const unsigned char* data, unsigned int count,
+	unsigned int t0, unsigned int t1, unsigned int tl)
+{
+	unsigned char byte;
+	unsigned int bit;
+
+	while (count--)
+	{
+		byte = *data++;
+		waveformRun(w, 2);						// ld
+		waveformRun(w, 3);						// rcall send_led_strip_byte
+		for(bit=0;bit<8;bit++)
+		{
+			waveformRun(w, 3);					// rcall send_led_strip_bit
+			w->carry = byte >> 7;				// rol
+			byte <<= 1;
+			waveformRun(w, 1);
+			waveformEdge(w, 2);					// sbi
+			waveformRun(w, t0);
+			if (w->carry)
+				waveformRun(w, 2);				// brcs taken over the cbi
+			else
+			{
+				waveformRun(w, 1);
+				waveformEdge(w, 2);				// cbi
+			}
+			waveformRun(w, t1);
+			if (!w->carry)
+				waveformRun(w, 2);				// brcc taken over the cbi
+			else
+			{
+				waveformRun(w, 1);
+				waveformEdge(w, 2);				// cbi
+			}
+			waveformRun(w, tl);
+			waveformRun(w, 4);					// ret
+		}
+		waveformRun(w, 4);						// ret
+		waveformRun(w, 1);						// dec
+		waveformRun(w, count ? 2 : 1);			// brne
+	}
+}
+
+// led_strip_parallel_byte() for strip 0, pin 7 of the slice
+static void waveformParallel(waveform_T* w, const unsigned char* data, unsigned int count,
+	unsigned int t0, unsigned int t1)
+{
+	unsigned char byte;
+	unsigned int bit;
+
+	while (count--)
+	{
+		byte = *data++;
+		waveformRun(w, 1);						// ldi
+		for(bit=0;bit<8;bit++)
+		{
+			w->carry = byte >> 7;
+			byte <<= 1;
+			waveformRun(w, 16);					// lsl, rol of 8 strips
+			waveformEdge(w, 1);					// out, all high
+			waveformRun(w, t0);
+			if (w->carry)
+				waveformRun(w, 1);				// out, the strip stays high
+			else
+				waveformEdge(w, 1);				// out, the strip falls
+			waveformRun(w, t1);
+			if (w->carry)
+				waveformEdge(w, 1);				// out, all low
+			else
+				waveformRun(w, 1);
+			waveformRun(w, 1);					// dec
+			waveformRun(w, bit < 7 ? 2 : 1);	// brne
+		}
+	}
+}
+
+// LED_STRIP_USART, 4 pattern bits of 2 * half cycles per strip bit, a 1 high for
+// ones of them; the refill interrupt only ever stretches the low time, it is left out
+static void waveformUsart(waveform_T* w, const unsigned char* data, unsigned int count, unsigned int half,
+	unsigned int ones)
+{
+	unsigned char byte;
+	unsigned int bit;
+
+	while (count--)
+	{
+		byte = *data++;
+		for(bit=0;bit<8;bit++)
+		{
+			w->carry = byte >> 7;
+			byte <<= 1;
+			waveformEdge(w, 0);					// 1000, 1110 or 1100
+			waveformEdge(w, 2 * half * (w->carry ? ones : 1));
+			waveformRun(w, 2 * half * (w->carry ? 4 - ones : 3));
+		}
+	}
+}
+
+// Decode the edges and measure them, returns 1 if the bytes came out, every high
+// time is within the tolerance, every low time and slot at least the minimum of
+// the chip and no low time reaches the latch. The shortest low times and slot
+// are reported; the bit-banged slot is stretched to the nominal one, the USART
+// slot is four pattern bits whatever the chip.
+static int waveformCheck(const waveform_T* w, unsigned long f, const waveform_chip_T* chip,
+	const unsigned char* data, unsigned long* high0, unsigned long* high1, unsigned long* low0,
+	unsigned long* low1, unsigned long* slot)
+{
+	unsigned long threshold = (chip->t0h + chip->t1h) / 2;
+	unsigned long high, low, period;
+	unsigned long* shortest;
+	unsigned char byte = 0;
+	unsigned int i;
+	int ok = 1;
+
+	*high0 = 0;
+	*high1 = 0;
+	*low0 = 0;
+	*low1 = 0;
+	*slot = 0;
+	for(i=0;i<w->edges;i+=2)
+	{
+		high = LED_STRIP_NS(f, w->edge[i + 1] - w->edge[i]);
+		byte = (byte << 1) | (high > threshold);
+		if (high > threshold)
+		{
+			*high1 = high;
+			if (high + chip->tol < chip->t1h || high > chip->t1h + chip->tol)
+				ok = 0;
+		}
+		else
+		{
+			*high0 = high;
+			if (high + chip->tol < chip->t0h || high > chip->t0h + chip->tol)
+				ok = 0;
+		}
+		if (i + 2 < w->edges)
+		{
+			period = LED_STRIP_NS(f, w->edge[i + 2] - w->edge[i]);
+			if (!*slot || period < *slot)
+				*slot = period;
+			if (period < chip->min)
+				ok = 0;
+			// a low time held until the latch ends the frame
+			low = LED_STRIP_NS(f, w->edge[i + 2] - w->edge[i + 1]);
+			if (low >= LED_STRIP_LATCH_US * 1000UL)
+				ok = 0;
+			shortest = high > threshold ? low1 : low0;
+			if (!*shortest || low < *shortest)
+				*shortest = low;
+			if (low < (high > threshold ? chip->t1l : chip->t0l))
+				ok = 0;
+		}
+		if ((i / 2) % 8 == 7 && byte != data[i / 16])
+			ok = 0;
+	}
+	return ok;
+}
+
+static int waveformReport(const char* output, unsigned long f, const waveform_chip_T* chip,
+	const waveform_T* w, const unsigned char* data, int refused)
+{
+	unsigned long high0, high1, low0, low1, slot;
+	int ok = waveformCheck(w, f, chip, data, &high0, &high1, &low0, &low1, &slot);
+	int agrees = ok != refused;
+
+	printf("%8.4f MHz  %-8s %-9s T0H %4lu  T1H %4lu  T0L %4lu  T1L %4lu  slot %4lu ns  %s%s\n", f / 1e6, output,
+		chip->name, high0, high1, low0, low1, slot, refused ? "refused" : "ok", agrees ? "" : "  MISMATCH");
+	return !agrees;
+}
+
+int main(void)
+{
+	unsigned char data[WAVEFORM_BYTES];
+	const waveform_chip_T* chip;
+	waveform_T w;
+	unsigned long f;
+	unsigned int i, c;
+	unsigned long half, half2;
+	unsigned int ones;
+	int failed = 0;
+	int refused;
+
+	// both edges of every bit pattern, then a pseudo random tail
+	data[0] = 0x00;
+	data[1] = 0xFF;
+	data[2] = 0xA5;
+	data[3] = 0x5A;
+	for(i=4;i<WAVEFORM_BYTES;i++)
+		data[i] = (data[i - 1] * 73 + 41) ^ i;
+
+	for(i=0;i<WAVEFORM_CLOCKS;i++)
+	{
+		f = waveform_clocks[i];
+		for(c=0;c<WAVEFORM_CHIPS;c++)
+		{
+			chip = &waveform_chips[c];
+
+			memset(&w, 0, sizeof(w));
+			waveformBitBang(&w, data, WAVEFORM_BYTES, LED_STRIP_BIT_T0_NOPS(f, chip->t0h),
+				LED_STRIP_BIT_T1_NOPS(f, chip->t0h, chip->t1h), LED_STRIP_BIT_TL_NOPS(f, chip->t0h, chip->t1h, chip->slot));
+			// the #if of ledstrip.c
+			refused = LED_STRIP_MISSES(f, LED_STRIP_BIT_T0H(f, chip->t0h), chip->t0h, chip->tol) ||
+				LED_STRIP_MISSES(f, LED_STRIP_BIT_T1H(f, chip->t0h, chip->t1h), chip->t1h, chip->tol) ||
+				LED_STRIP_SHORT(f, LED_STRIP_BIT_T0H(f, chip->t0h), LED_STRIP_BIT_T1H(f, chip->t0h, chip->t1h),
+					LED_STRIP_BIT_SLOT(f, chip->t0h, chip->t1h, chip->slot), chip->t0l, chip->t1l, chip->min);
+			failed += waveformReport("bitbang", f, chip, &w, data, refused);
+
+			memset(&w, 0, sizeof(w));
+			waveformParallel(&w, data, WAVEFORM_BYTES, LED_STRIP_PAR_T0_NOPS(f, chip->t0h),
+				LED_STRIP_PAR_T1_NOPS(f, chip->t0h, chip->t1h));
+			refused = LED_STRIP_MISSES(f, LED_STRIP_PAR_T0H(f, chip->t0h), chip->t0h, chip->tol) ||
+				LED_STRIP_MISSES(f, LED_STRIP_PAR_T1H(f, chip->t0h, chip->t1h), chip->t1h, chip->tol) ||
+				LED_STRIP_SHORT(f, LED_STRIP_PAR_T0H(f, chip->t0h), LED_STRIP_PAR_T1H(f, chip->t0h, chip->t1h),
+					LED_STRIP_PAR_SLOT(f, chip->t0h, chip->t1h), chip->t0l, chip->t1l, chip->min);
+			failed += waveformReport("parallel", f, chip, &w, data, refused);
+
+			memset(&w, 0, sizeof(w));
+			// the pattern selection of ledstrip.c, a refused clock is run with 1110
+			ones = 3;
+			half = LED_STRIP_USART_HALF(f, 3, chip->t0h, chip->t1h, chip->tol, chip->t0l, chip->t1l, chip->min);
+			refused = !LED_STRIP_USART_FITS(f, half, 3, chip->t0h, chip->t1h, chip->tol, chip->t0l, chip->t1l, chip->min);
+			half2 = LED_STRIP_USART_HALF(f, 2, chip->t0h, chip->t1h, chip->tol, chip->t0l, chip->t1l, chip->min);
+			if (refused && LED_STRIP_USART_FITS(f, half2, 2, chip->t0h, chip->t1h, chip->tol, chip->t0l, chip->t1l, chip->min))
+			{
+				ones = 2;
+				half = half2;
+				refused = 0;
+			}
+			waveformUsart(&w, data, WAVEFORM_BYTES, half, ones);
+			failed += waveformReport(ones == 3 ? "usart" : "usart2", f, chip, &w, data, refused);
+		}
+	}
+	if (failed)
+		printf("%d mismatches\n", failed);
+	return failed ? 1 : 0;
+}
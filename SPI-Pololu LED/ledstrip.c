@@ -0,0 +1,576 @@
+//*****************************************************************************
+// File Name	: ledstrip.c
+// Title		: Pololu LED strip output
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// The LED 1-wire code is from the Pololu examples.
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include <avr/pgmspace.h>		// include program memory support
+#include <util/delay.h>			// include delay support
+#include "pin.h"
+#include "profile.h"
+#include "ledstrip.h"
+#include "ledstripdither.h"
+
+#if defined(LED_STRIP_DITHER) && defined(LED_STRIP_PARALLEL)
+#error "LED_STRIP_DITHER can not be combined with LED_STRIP_PARALLEL"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+#if defined(LED_STRIP_GAMMA) && defined(LED_STRIP_DITHER)
+// output level for each color value in 12 bits, 4095 * (value / 255) ^ 2.2
+static const unsigned int ledstrip_gamma[256] PROGMEM =
+{
+	   0,    0,    0,    0,    0,    1,    1,    2,    2,    3,    3,    4,    5,    6,    7,    8,
+	   9,   11,   12,   14,   15,   17,   19,   21,   23,   25,   27,   29,   32,   34,   37,   40,
+	  43,   46,   49,   52,   55,   59,   62,   66,   70,   73,   77,   82,   86,   90,   95,   99,
+	 104,  109,  114,  119,  124,  129,  135,  140,  146,  152,  158,  164,  170,  176,  182,  189,
+	 196,  202,  209,  216,  224,  231,  238,  246,  254,  261,  269,  277,  286,  294,  302,  311,
+	 320,  328,  337,  347,  356,  365,  375,  384,  394,  404,  414,  424,  435,  445,  456,  467,
+	 477,  488,  500,  511,  522,  534,  545,  557,  569,  581,  594,  606,  619,  631,  644,  657,
+	 670,  683,  697,  710,  724,  738,  752,  766,  780,  794,  809,  823,  838,  853,  868,  884,
+	 899,  914,  930,  946,  962,  978,  994, 1011, 1027, 1044, 1061, 1078, 1095, 1112, 1130, 1147,
+	1165, 1183, 1201, 1219, 1237, 1256, 1274, 1293, 1312, 1331, 1350, 1370, 1389, 1409, 1429, 1449,
+	1469, 1489, 1509, 1530, 1551, 1572, 1593, 1614, 1635, 1657, 1678, 1700, 1722, 1744, 1766, 1789,
+	1811, 1834, 1857, 1880, 1903, 1926, 1950, 1974, 1997, 2021, 2045, 2070, 2094, 2119, 2143, 2168,
+	2193, 2219, 2244, 2270, 2295, 2321, 2347, 2373, 2400, 2426, 2453, 2479, 2506, 2534, 2561, 2588,
+	2616, 2644, 2671, 2700, 2728, 2756, 2785, 2813, 2842, 2871, 2900, 2930, 2959, 2989, 3019, 3049,
+	3079, 3109, 3140, 3170, 3201, 3232, 3263, 3295, 3326, 3358, 3390, 3421, 3454, 3486, 3518, 3551,
+	3584, 3617, 3650, 3683, 3716, 3750, 3784, 3818, 3852, 3886, 3920, 3955, 3990, 4025, 4060, 4095
+};
+#elif defined(LED_STRIP_GAMMA)
+// output level for each color value, 255 * (value / 255) ^ 2.2
+static const unsigned char ledstrip_gamma[256] PROGMEM =
+{
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+	  1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+	  3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+	  6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+	 12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+	 20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+	 30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+	 42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+	 56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+	 73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+	 91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+	113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+	137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+	163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+	192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+	223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+#endif
+
+static unsigned int ledstrip_level = 256;			// brightness + 1
+
+#ifdef LED_STRIP_DITHER
+// Residues of the 12 bit levels below what was sent, 4 bits per color, red and
+// green in the first byte and blue in the second. LEDs past LED_STRIP_DITHER_LEDS
+// share the last entry.
+static unsigned char ledstrip_residue[LED_STRIP_DITHER_LEDS + 1][2];
+static unsigned char ledstrip_dither_led;			// LED of the next led_strip_prepare()
+#endif
+
+//----- Functions --------------------------------------------------------------
+
+void led_strip_brightness(unsigned char brightness)
+{
+	ledstrip_level = brightness + 1;
+}
+
+#ifdef LED_STRIP_DITHER
+
+// Gamma and brightness for one color byte in 12 bits, plus the residue this color of
+// the LED was left with on the last refresh, see ledstripdither.h
+static inline unsigned char led_strip_correct(unsigned char value, unsigned char * residue)
+{
+#ifdef LED_STRIP_GAMMA
+	unsigned int level = pgm_read_word(&ledstrip_gamma[value]);
+#else
+	unsigned int level = LED_STRIP_DITHER_LINEAR(value);
+#endif
+	return led_strip_dither(level, ledstrip_level, residue);
+}
+
+// the 8 bit colors of the next LED
+static inline void led_strip_correct_led(const rgb_color * color, unsigned char * red,
+	unsigned char * green, unsigned char * blue)
+{
+	unsigned char * residue = ledstrip_residue[ledstrip_dither_led];
+	unsigned char r = residue[0] >> 4;
+	unsigned char g = residue[0] & 0x0F;
+
+	if (ledstrip_dither_led < LED_STRIP_DITHER_LEDS)
+		ledstrip_dither_led++;
+	*red = led_strip_correct(color->red, &r);
+	*green = led_strip_correct(color->green, &g);
+	*blue = led_strip_correct(color->blue, &residue[1]);
+	residue[0] = (r << 4) | g;
+}
+
+#else
+
+// gamma and brightness for one color byte, about 10 cycles
+static inline unsigned char led_strip_correct(unsigned char value)
+{
+#ifdef LED_STRIP_GAMMA
+	value = pgm_read_byte(&ledstrip_gamma[value]);
+#endif
+	return ((unsigned int)value * ledstrip_level) >> 8;
+}
+
+static inline void led_strip_correct_led(const rgb_color * color, unsigned char * red,
+	unsigned char * green, unsigned char * blue)
+{
+	*red = led_strip_correct(color->red);
+	*green = led_strip_correct(color->green);
+	*blue = led_strip_correct(color->blue);
+}
+
+#endif
+
+// the first LED of a refresh
+static inline void led_strip_restart(void)
+{
+#ifdef LED_STRIP_DITHER
+	ledstrip_dither_led = 0;
+#endif
+}
+
+// the LED_STRIP_BYTES bytes of one LED in the order the chip takes them,
+// an RGBW chip gets the part all three colors share on its white LED
+static inline void led_strip_prepare(const rgb_color * color, unsigned char * out)
+{
+	unsigned char red, green, blue;
+#if LED_STRIP_BYTES == 4
+	unsigned char white;
+#endif
+
+	led_strip_correct_led(color, &red, &green, &blue);
+#if LED_STRIP_BYTES == 4
+	white = red < green ? red : green;
+	if (blue < white)
+		white = blue;
+	red -= white;
+	green -= white;
+	blue -= white;
+	out[3] = white;
+#endif
+#if LED_STRIP_ORDER == LED_STRIP_RGB
+	out[0] = red;
+	out[1] = green;
+#else
+	out[0] = green;
+	out[1] = red;
+#endif
+	out[2] = blue;
+}
+
+#ifdef LED_STRIP_USART
+
+#if !defined(UMSEL00)
+#error "LED_STRIP_USART needs a USART with master SPI mode (ATmega48/88/168)"
+#endif
+
+//----- Defines ---------------------------------------------------------------
+// One pattern bit is 2 * half cycles, UBRR0 = half - 1. A 1 is high for three
+// pattern bits, or for two where three can not meet the high times, the low
+// times and the slot of LED_STRIP_CHIP (see ledstripchip.h).
+#define LED_STRIP_USART_FIT(half, ones)	\
+	LED_STRIP_USART_FITS(F_CPU, half, ones, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS, LED_STRIP_TOL_NS,	\
+		LED_STRIP_T0L_MIN_NS, LED_STRIP_T1L_MIN_NS, LED_STRIP_SLOT_MIN_NS)
+#ifdef LED_STRIP_USART_NS
+#define LED_STRIP_USART_HALF3		LED_STRIP_CYCLES(F_CPU / 2, LED_STRIP_USART_NS)
+#define LED_STRIP_USART_HALF2		LED_STRIP_USART_HALF3
+#else
+#define LED_STRIP_USART_HALF3		LED_STRIP_USART_HALF(F_CPU, 3, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS, LED_STRIP_TOL_NS,	\
+										LED_STRIP_T0L_MIN_NS, LED_STRIP_T1L_MIN_NS, LED_STRIP_SLOT_MIN_NS)
+#define LED_STRIP_USART_HALF2		LED_STRIP_USART_HALF(F_CPU, 2, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS, LED_STRIP_TOL_NS,	\
+										LED_STRIP_T0L_MIN_NS, LED_STRIP_T1L_MIN_NS, LED_STRIP_SLOT_MIN_NS)
+#endif
+#define LED_STRIP_XCK				D, 4		// has to be an output in master mode
+#define LED_STRIP_TXD				D, 1		// strip data line
+
+#if LED_STRIP_USART_FIT(LED_STRIP_USART_HALF3, 3)
+#define LED_STRIP_USART_ONES		3
+#define LED_STRIP_USART_UBRR		(LED_STRIP_USART_HALF3 - 1)
+#elif LED_STRIP_USART_FIT(LED_STRIP_USART_HALF2, 2)
+#define LED_STRIP_USART_ONES		2
+#define LED_STRIP_USART_UBRR		(LED_STRIP_USART_HALF2 - 1)
+#else
+#error "The USART can not meet the high times, low times or slot of LED_STRIP_CHIP at this F_CPU"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+PIN_DEFINE(ledstripXck, LED_STRIP_XCK)
+PIN_DEFINE(ledstripTxd, LED_STRIP_TXD)
+
+// pattern byte for two strip bits, msb first
+#if LED_STRIP_USART_ONES == 3
+static const unsigned char ledstrip_pattern[4] = { 0x88, 0x8E, 0xE8, 0xEE };	// 0 -> 1000, 1 -> 1110
+#else
+static const unsigned char ledstrip_pattern[4] = { 0x88, 0x8C, 0xC8, 0xCC };	// 0 -> 1000, 1 -> 1100
+#endif
+
+static rgb_color* ledstrip_src;						// color being sent
+static led_strip_generator ledstrip_next;			// generator, 0 to send from ledstrip_src
+static rgb_color ledstrip_pixel;					// last generated color
+static unsigned int ledstrip_left;					// colors not started yet
+static unsigned char ledstrip_out[LED_STRIP_BYTES];	// bytes of the LED being sent
+static unsigned char ledstrip_byte;					// component being sent, next bits on top
+static unsigned char ledstrip_pairs = 0;			// bit pairs left in ledstrip_byte
+static unsigned char ledstrip_component = 0;		// next component in ledstrip_out
+
+//----- Functions --------------------------------------------------------------
+
+ISR(USART_UDRE_vect)
+{
+	if (ledstrip_pairs == 0)
+	{
+		if (ledstrip_component == 0)
+		{
+			if (ledstrip_left == 0)
+			{
+				// last byte moved to the shifter, TXC0 sets when it is out
+				UCSR0B &= ~(1 << UDRIE0);
+				UCSR0A = (1 << TXC0);
+				return;
+			}
+			ledstrip_left--;
+			if (ledstrip_next)
+			{
+				ledstrip_next(&ledstrip_pixel);
+				led_strip_prepare(&ledstrip_pixel, ledstrip_out);
+			}
+			else
+				led_strip_prepare(ledstrip_src++, ledstrip_out);
+		}
+		ledstrip_byte = ledstrip_out[ledstrip_component];
+		if (++ledstrip_component == LED_STRIP_BYTES)
+			ledstrip_component = 0;
+		ledstrip_pairs = 4;
+	}
+
+	UDR0 = ledstrip_pattern[ledstrip_byte >> 6];
+	ledstrip_byte <<= 2;
+	ledstrip_pairs--;
+}
+
+static void led_strip_begin(rgb_color * colors, led_strip_generator next, unsigned int count)
+{
+	if (!(UCSR0B & (1 << TXEN0)))
+	{
+		// the line rests low until the transmitter takes the pin over
+		ledstripTxdLow();
+		ledstripTxdOutput();
+		ledstripXckOutput();
+		UBRR0 = 0;
+		UCSR0C = (1 << UMSEL01) | (1 << UMSEL00);	// master SPI mode, msb first
+		UCSR0B = (1 << TXEN0);
+		UBRR0 = LED_STRIP_USART_UBRR;				// only after enabling the transmitter
+	}
+
+	led_strip_restart();
+	ledstrip_src = colors;
+	ledstrip_next = next;
+	ledstrip_left = count;
+	ledstrip_pairs = 0;
+	ledstrip_component = 0;
+	UCSR0B |= (1 << UDRIE0);
+}
+
+void led_strip_start(rgb_color * colors, unsigned int count)
+{
+	led_strip_begin(colors, 0, count);
+}
+
+unsigned char led_strip_busy(void)
+{
+	return (UCSR0B & (1 << UDRIE0)) || !(UCSR0A & (1 << TXC0));
+}
+
+void led_strip_write(rgb_color * colors, unsigned int count)
+{
+  PROFILE_ENTER(PROFILE_STRIP_WRITE);
+  led_strip_start(colors, count);
+  while(led_strip_busy());
+  _delay_us(80);  // Send the reset signal.
+  PROFILE_EXIT(PROFILE_STRIP_WRITE);
+}
+
+void led_strip_generate(led_strip_generator next, unsigned int count)
+{
+  PROFILE_ENTER(PROFILE_STRIP_WRITE);
+  led_strip_begin(0, next, count);
+  while(led_strip_busy());
+  _delay_us(80);  // Send the reset signal.
+  PROFILE_EXIT(PROFILE_STRIP_WRITE);
+}
+
+#else
+
+//----- Functions --------------------------------------------------------------
+
+void led_strip_start(rgb_color * colors, unsigned int count)
+{
+  led_strip_write(colors, count);
+}
+
+unsigned char led_strip_busy(void)
+{
+  return 0;
+}
+
+#ifdef LED_STRIP_PARALLEL
+
+#if defined(LED_STRIP_USART) || (LED_STRIP_PARALLEL < 1) || (LED_STRIP_PARALLEL > 8)
+#error "LED_STRIP_PARALLEL takes 1 to 8 strips and can not be combined with LED_STRIP_USART"
+#endif
+
+//----- Defines ---------------------------------------------------------------
+// nops after the rising edge, before the 0 bits fall, then before the 1 bits fall
+#define LED_STRIP_T0H_NOPS			LED_STRIP_PAR_T0_NOPS(F_CPU, LED_STRIP_T0H_NS)
+#define LED_STRIP_T1H_NOPS			LED_STRIP_PAR_T1_NOPS(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS)
+// pins of the strips, strip i is on pin 7 - i
+#define LED_STRIP_PARALLEL_MASK		((unsigned char)(0xFF00 >> LED_STRIP_PARALLEL))
+
+#if LED_STRIP_MISSES(F_CPU, LED_STRIP_PAR_T0H(F_CPU, LED_STRIP_T0H_NS), LED_STRIP_T0H_NS, LED_STRIP_TOL_NS) || \
+	LED_STRIP_MISSES(F_CPU, LED_STRIP_PAR_T1H(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS), LED_STRIP_T1H_NS, LED_STRIP_TOL_NS)
+#error "F_CPU can not meet the high times of LED_STRIP_CHIP"
+#endif
+#if LED_STRIP_SHORT(F_CPU, LED_STRIP_PAR_T0H(F_CPU, LED_STRIP_T0H_NS), LED_STRIP_PAR_T1H(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS),	\
+	LED_STRIP_PAR_SLOT(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS), LED_STRIP_T0L_MIN_NS, LED_STRIP_T1L_MIN_NS, LED_STRIP_SLOT_MIN_NS)
+#error "F_CPU can not meet the low times or the slot of LED_STRIP_CHIP"
+#endif
+
+//----- Functions --------------------------------------------------------------
+
+/** led_strip_parallel_byte sends one color component to every strip, d[i] to strip i.
+ Each bit slot sets all strips high, drops the ones sending 0 after LED_STRIP_T0H_NS and
+ the rest after LED_STRIP_T1H_NS. The slice for a bit slot, bit 7 - i holding the bit of
+ strip i, is shifted together from the 8 bytes in the low time of the slot before:
+ 16 cycles, the whole slot is 22 cycles plus the nops of the two high times. */
+static inline void led_strip_parallel_byte(unsigned char * d)
+{
+  unsigned char d0 = d[0], d1 = d[1], d2 = d[2], d3 = d[3];
+  unsigned char d4 = d[4], d5 = d[5], d6 = d[6], d7 = d[7];
+  unsigned char bits, slice;
+
+  asm volatile(
+      "ldi %[bits], 8\n"
+      "1:\n"
+      "lsl %[d0]\n" "rol %[slice]\n"
+      "lsl %[d1]\n" "rol %[slice]\n"
+      "lsl %[d2]\n" "rol %[slice]\n"
+      "lsl %[d3]\n" "rol %[slice]\n"
+      "lsl %[d4]\n" "rol %[slice]\n"
+      "lsl %[d5]\n" "rol %[slice]\n"
+      "lsl %[d6]\n" "rol %[slice]\n"
+      "lsl %[d7]\n" "rol %[slice]\n"
+      "out %[port], %[mask]\n"          // All strips high.
+      ".rept %[t0]\n" "nop\n" ".endr\n"
+      "out %[port], %[slice]\n"         // Strips sending 0 low.
+      ".rept %[t1]\n" "nop\n" ".endr\n"
+      "out %[port], __zero_reg__\n"     // All strips low.
+      "dec %[bits]\n"
+      "brne 1b\n"
+      : [d0] "+r" (d0), [d1] "+r" (d1), [d2] "+r" (d2), [d3] "+r" (d3),
+        [d4] "+r" (d4), [d5] "+r" (d5), [d6] "+r" (d6), [d7] "+r" (d7),
+        [bits] "=&d" (bits), [slice] "=&r" (slice)
+      : [port] "I" (_SFR_IO_ADDR(LED_STRIP_PARALLEL_PORT)),
+        [mask] "r" (LED_STRIP_PARALLEL_MASK),
+        [t0] "n" (LED_STRIP_T0H_NOPS),
+        [t1] "n" (LED_STRIP_T1H_NOPS)
+  );
+}
+
+/** led_strip_output cuts the colors into LED_STRIP_PARALLEL equal runs, run i goes to strip i,
+ and sends them at the same time; strips past the end of the colors get black.
+ With a generator every strip gets the same count colors. */
+static void __attribute__((noinline)) led_strip_output(rgb_color * colors, led_strip_generator next, unsigned int count)
+{
+  rgb_color pixel[LED_STRIP_PARALLEL];
+  unsigned char out[LED_STRIP_PARALLEL][LED_STRIP_BYTES];
+  unsigned char d[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  unsigned int length = next ? count : (count + LED_STRIP_PARALLEL - 1) / LED_STRIP_PARALLEL;
+  unsigned int led, index;
+  unsigned char i, k;
+
+  PROFILE_ENTER(PROFILE_STRIP_WRITE);
+
+  // The port belongs to the strips, all of them driving low.
+  LED_STRIP_PARALLEL_PORT = 0;
+  LED_STRIP_PARALLEL_DDR = LED_STRIP_PARALLEL_MASK;
+
+  cli();
+  for(led = 0; led < length; led++)
+  {
+    // Gather the colors while the lines are low.
+    if (next)
+    {
+      next(&pixel[0]);
+      for(i = 1; i < LED_STRIP_PARALLEL; i++)
+        pixel[i] = pixel[0];
+    }
+    else
+    {
+      index = led;
+      for(i = 0; i < LED_STRIP_PARALLEL; i++, index += length)
+        pixel[i] = index < count ? colors[index] : (rgb_color){ 0, 0, 0 };
+    }
+
+    // In the byte order of the chip like the single strip code.
+    for(i = 0; i < LED_STRIP_PARALLEL; i++)
+      led_strip_prepare(&pixel[i], out[i]);
+    for(k = 0; k < LED_STRIP_BYTES; k++)
+    {
+      for(i = 0; i < LED_STRIP_PARALLEL; i++)
+        d[i] = out[i][k];
+      led_strip_parallel_byte(d);
+    }
+
+#ifdef LED_STRIP_CHUNKED
+    // Serve pending interrupts between colors, the lines are low here.
+    sei(); asm volatile("nop\n"); cli();
+#endif
+  }
+  sei();
+  _delay_us(80);  // Send the reset signal.
+  PROFILE_EXIT(PROFILE_STRIP_WRITE);
+}
+
+#else
+
+//----- Defines ---------------------------------------------------------------
+// nops of the bit slot, see ledstripchip.h
+#define LED_STRIP_T0_NOPS			LED_STRIP_BIT_T0_NOPS(F_CPU, LED_STRIP_T0H_NS)
+#define LED_STRIP_T1_NOPS			LED_STRIP_BIT_T1_NOPS(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS)
+#define LED_STRIP_TL_NOPS			LED_STRIP_BIT_TL_NOPS(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS, LED_STRIP_SLOT_NS)
+
+#if LED_STRIP_MISSES(F_CPU, LED_STRIP_BIT_T0H(F_CPU, LED_STRIP_T0H_NS), LED_STRIP_T0H_NS, LED_STRIP_TOL_NS) || \
+	LED_STRIP_MISSES(F_CPU, LED_STRIP_BIT_T1H(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS), LED_STRIP_T1H_NS, LED_STRIP_TOL_NS)
+#error "F_CPU can not meet the high times of LED_STRIP_CHIP"
+#endif
+#if LED_STRIP_SHORT(F_CPU, LED_STRIP_BIT_T0H(F_CPU, LED_STRIP_T0H_NS), LED_STRIP_BIT_T1H(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS),	\
+	LED_STRIP_BIT_SLOT(F_CPU, LED_STRIP_T0H_NS, LED_STRIP_T1H_NS, LED_STRIP_SLOT_NS),	\
+	LED_STRIP_T0L_MIN_NS, LED_STRIP_T1L_MIN_NS, LED_STRIP_SLOT_MIN_NS)
+#error "F_CPU can not meet the low times or the slot of LED_STRIP_CHIP"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+PIN_DEFINE(ledstripData, LED_STRIP_DATA)
+
+//----- Functions --------------------------------------------------------------
+
+/** led_strip_write sends a series of colors to the LED strip, updating the LEDs.
+ The colors parameter should point to an array of rgb_color structs that hold the colors to send.
+ The count parameter is the number of colors to send.
+ This function takes about 1.1 ms to update 30 LEDs.
+ Interrupts must be disabled during that time, so any interrupt-based library
+ can be negatively affected by this function. With LED_STRIP_CHUNKED they are only
+ disabled while one LED is sent, see ledstrip.h.
+ The high times and the slot length come from LED_STRIP_CHIP, rounded to whole cycles
+ of F_CPU, see ledstripchip.h. With the Pololu profile:
+  0 pulse  = 400 ns (375 ns at 8 MHz)
+  1 pulse  = 850 ns (875 ns at 8 MHz, 875 ns at 16 MHz)
+  "period" = 1300 ns (2 us at 8 MHz, the low time is stretched)
+ led_strip_output takes the colors from the array, or from the generator if next is set.
+ */
+static void __attribute__((noinline)) led_strip_output(rgb_color * colors, led_strip_generator next, unsigned int count)
+{
+  rgb_color pixel;
+  unsigned char out[LED_STRIP_BYTES];
+
+  PROFILE_ENTER(PROFILE_STRIP_WRITE);
+
+  led_strip_restart();
+
+  // Set the pin to be an output driving low.
+  ledstripDataLow();
+  ledstripDataOutput();
+
+  cli();   // Disable interrupts temporarily because we don't want our pulse timing to be messed up.
+  while(count--)
+  {
+    unsigned char * byte = out;
+    unsigned char bytes = LED_STRIP_BYTES;
+
+    // The generator and the corrections run between two colors, while the line is low.
+    if (next)
+      next(&pixel);
+    else
+      pixel = *colors++;
+    led_strip_prepare(&pixel, out);
+
+    // Send the bytes of one LED.
+    // The assembly below also increments the 'byte' pointer.
+    asm volatile(
+        "send_led_strip_next%=:\n"
+        "ld __tmp_reg__, %a0+\n"
+        "rcall send_led_strip_byte%=\n"
+        "dec %1\n"
+        "brne send_led_strip_next%=\n"
+        "rjmp led_strip_asm_end%=\n"     // Jump past the assembly subroutines.
+
+        // send_led_strip_byte subroutine:  Sends a byte to the LED strip.
+        "send_led_strip_byte%=:\n"
+        "rcall send_led_strip_bit%=\n"  // Send most-significant bit (bit 7).
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"
+        "rcall send_led_strip_bit%=\n"  // Send least-significant bit (bit 0).
+        "ret\n"
+
+        // send_led_strip_bit subroutine:  Sends single bit to the LED strip by driving the data line
+        // high for some time.  The amount of time the line is high depends on whether the bit is 0 or 1,
+        // but this function always takes the same time, one slot.
+        "send_led_strip_bit%=:\n"
+        "rol __tmp_reg__\n"                      // Rotate left through carry.
+        "sbi %2, %3\n"                           // Drive the line high.
+        ".rept %4\n" "nop\n" ".endr\n"
+        "brcs .+2\n" "cbi %2, %3\n"              // If the bit to send is 0, drive the line low now.
+        ".rept %5\n" "nop\n" ".endr\n"
+        "brcc .+2\n" "cbi %2, %3\n"              // If the bit to send is 1, drive the line low now.
+        ".rept %6\n" "nop\n" ".endr\n"
+        "ret\n"
+        "led_strip_asm_end%=: "
+        : "+b" (byte),            // %a0 points to the bytes to send
+          "+r" (bytes)            // %1 counts them
+        : "I" (_SFR_IO_ADDR(PIN_PORT(LED_STRIP_DATA))),   // %2 is the port register (e.g. PORTC)
+          "I" (PIN_BIT(LED_STRIP_DATA)),    // %3 is the pin number (0-7)
+          "n" (LED_STRIP_T0_NOPS),  // %4 to %6 are the nops of the slot
+          "n" (LED_STRIP_T1_NOPS),
+          "n" (LED_STRIP_TL_NOPS)
+    );
+
+#ifdef LED_STRIP_CHUNKED
+    // Serve pending interrupts between colors, the line is low here.
+    sei(); asm volatile("nop\n"); cli();
+#endif
+  }
+  sei();          // Re-enable interrupts now that we are done.
+  _delay_us(80);  // Send the reset signal.
+  PROFILE_EXIT(PROFILE_STRIP_WRITE);
+}
+
+#endif
+
+void led_strip_write(rgb_color * colors, unsigned int count)
+{
+  led_strip_output(colors, 0, count);
+}
+
+void led_strip_generate(led_strip_generator next, unsigned int count)
+{
+  led_strip_output(0, next, count);
+}
+
+#endif
@@ -0,0 +1,102 @@
+//*****************************************************************************
+// File Name	: ledstrip.h
+// Title		: Pololu LED strip output
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// The bit timing is generated in software, see led_strip_write(), with
+// the high times of LED_STRIP_CHIP counted out in cycles of F_CPU (see
+// ledstripchip.h), or with LED_STRIP_USART by the USART in master SPI mode:
+//
+// Every pair of strip bits becomes one pattern byte, shifted out at one
+// pattern bit per LED_STRIP_USART_NS, a 1 as 1110 or, where that leaves it too
+// short a low time, as 1100. The shifter keeps the high times exact, each
+// pattern ends low. The UDRE interrupt refills the USART with interrupts
+// enabled, so other handlers only stretch the low time between two bit pairs,
+// which the strip accepts up to LED_STRIP_LATCH_US. This relies on TxD resting
+// at the last bit shifted out while the USART waits for data. Clocks on which neither pattern meets
+// LED_STRIP_CHIP stop the build with an #error.
+//
+// With LED_STRIP_PARALLEL several strips are sent at once, so a refresh takes
+// as long as the longest strip. A bit slot is 26 cycles at 8 MHz (3.3 us),
+// gathering the next colors of 8 strips between LEDs about 300 cycles with
+// the lines low. One LED takes about 115 us at 8 MHz, which is also the
+// interrupt latency with LED_STRIP_CHUNKED; the gather already uses most of
+// the LED_STRIP_LATCH_US budget at 8 MHz, chunked parallel output wants 16 MHz.
+//
+// A pattern byte lasts 16 cycles at 8 MHz, less than the refill interrupt,
+// so there the refresh runs at the pace of the interrupt and leaves little
+// CPU time. From 16 MHz on most of the refresh time is free.
+//
+// Without LED_STRIP_CHUNKED interrupts are disabled for the whole strip,
+// about 55 us per LED at 8 MHz (1.2 ms for 21 LEDs). An SPI byte that
+// arrives while the previous one is still unread is lost.
+//
+// With LED_STRIP_CHUNKED interrupts are enabled for one instruction after
+// every LED, so the worst-case interrupt latency is one LED:
+//
+//   24 bit slots * 17 cycles + ~30 cycles of loads and calls
+//   = ~440 cycles, 55 us at 8 MHz, ~40 us at 16 MHz, ~35 us at 20 MHz
+//
+// for the Pololu profile; the slot is about 1.3 us on fast clocks and 2 us at
+// 8 MHz, an RGBW LED has 32 of them.
+//
+// plus the longest interrupt handler. The SPI slave holds one received byte,
+// so a host that leaves at least 70 us between bytes (an SPI clock of
+// 100 kHz or less at 8 MHz) never overruns during a refresh. The interrupt
+// handlers that run in the gap stretch the low time of the last bit, they
+// must stay below LED_STRIP_LATCH_US together.
+//*****************************************************************************
+
+#ifndef ledstrip_h
+#define ledstrip_h
+
+//----- Include Files ---------------------------------------------------------
+#include "ledstripconf.h"
+#include "ledstripchip.h"
+
+//----- Typedefs --------------------------------------------------------------
+
+/** The rgb_color struct represents the color for an 8-bit RGB LED.
+    Examples:
+      Black:      (rgb_color){ 0, 0, 0 }
+      Pure red:   (rgb_color){ 255, 0, 0 }
+      Pure green: (rgb_color){ 0, 255, 0 }
+      Pure blue:  (rgb_color){ 0, 0, 255 }
+      White:      (rgb_color){ 255, 255, 255} */
+typedef struct rgb_color
+{
+  unsigned char red, green, blue;
+} rgb_color;
+
+/** A generator stores the color of the next LED in *color, it is called once per LED in
+ strip order. It runs in the gap between two LEDs with interrupts disabled, so together
+ with the interrupts served there it has to finish within LED_STRIP_LATCH_US. With
+ LED_STRIP_USART it is called from the refill interrupt. */
+typedef void (*led_strip_generator)(rgb_color * color);
+
+//----- Functions ---------------------------------------------------------------
+
+/** led_strip_write sends a series of colors to the LED strip, updating the LEDs.
+ The colors parameter should point to an array of rgb_color structs that hold the colors to send.
+ The count parameter is the number of colors to send. */
+void led_strip_write(rgb_color * colors, unsigned int count);
+
+/** led_strip_start starts sending the colors and returns, led_strip_busy returns 1 until
+ they are out. The colors must not change before that, and the next start has to wait
+ the strip reset time (80 us) after it. Without LED_STRIP_USART the start does the whole
+ write. */
+void led_strip_start(rgb_color * colors, unsigned int count);
+unsigned char led_strip_busy(void);
+
+/** led_strip_brightness scales every color sent from now on by (brightness + 1) / 256,
+ after the gamma table (LED_STRIP_GAMMA). Both are applied to each byte on the way out,
+ the colors passed in stay as they are. With LED_STRIP_DITHER the result keeps 12 bits
+ and the part below the 8 sent is added to the next refresh of the same LED, which
+ counts LEDs from the start of each write or generate. */
+void led_strip_brightness(unsigned char brightness);
+
+/** led_strip_generate sends count colors produced by the generator, without a buffer. */
+void led_strip_generate(led_strip_generator next, unsigned int count);
+
+#endif
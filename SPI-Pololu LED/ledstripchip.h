@@ -0,0 +1,178 @@
+//*****************************************************************************
+// File Name	: ledstripchip.h
+// Title		: LED chip timing profiles and bit slot timing
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// A bit slot starts with the line going high; it falls after T0H for a 0
+// and after T1H for a 1. The high times have to be met within the tolerance
+// of the chip. The low time after a 0 has to be at least T0L_MIN, after a 1
+// T1L_MIN, the whole slot at least SLOT_MIN, and no low time may reach
+// LED_STRIP_LATCH_US. The profiles give the nominal times from the
+// datasheets and the minimums as the nominal low times less the tolerance;
+// LED_STRIP_CHIP in ledstripconf.h picks one.
+//
+// The cycle counts are derived from the clock here, so every F_CPU gets its
+// own exact timing and ledstrip.c refuses to build when the nearest whole
+// cycles miss the tolerance. The macros take the clock as a parameter so
+// host/waveform.c can check them for every profile and clock; it steps
+// through the instructions of the slots and measures the pulses.
+//*****************************************************************************
+
+#ifndef ledstripchip_h
+#define ledstripchip_h
+
+//----- Defines ---------------------------------------------------------------
+// values of LED_STRIP_CHIP
+#define LED_STRIP_POLOLU			0			// the timing of the Pololu example code
+#define LED_STRIP_WS2812			1
+#define LED_STRIP_WS2811			2			// 800 kHz mode
+#define LED_STRIP_SK6812			3
+#define LED_STRIP_SK6812_RGBW		4			// a fourth, white byte per LED
+
+// byte orders on the wire
+#define LED_STRIP_GRB				0
+#define LED_STRIP_RGB				1
+
+// high times, slot length and tolerance of the high times in ns, shortest
+// low times and slot in ns, byte order
+#define LED_STRIP_POLOLU_T0H_NS		400
+#define LED_STRIP_POLOLU_T1H_NS		850
+#define LED_STRIP_POLOLU_SLOT_NS	1300
+#define LED_STRIP_POLOLU_TOL_NS		150
+#define LED_STRIP_POLOLU_T0L_MIN_NS	750			// 900 less the tolerance
+#define LED_STRIP_POLOLU_T1L_MIN_NS	300			// 450
+#define LED_STRIP_POLOLU_SLOT_MIN_NS	1150
+#define LED_STRIP_POLOLU_ORDER		LED_STRIP_GRB
+
+#define LED_STRIP_WS2812_T0H_NS		400
+#define LED_STRIP_WS2812_T1H_NS		800
+#define LED_STRIP_WS2812_SLOT_NS	1250
+#define LED_STRIP_WS2812_TOL_NS		150
+#define LED_STRIP_WS2812_T0L_MIN_NS	700			// 850
+#define LED_STRIP_WS2812_T1L_MIN_NS	300			// 450
+#define LED_STRIP_WS2812_SLOT_MIN_NS	1100
+#define LED_STRIP_WS2812_ORDER		LED_STRIP_GRB
+
+#define LED_STRIP_WS2811_T0H_NS		250
+#define LED_STRIP_WS2811_T1H_NS		600
+#define LED_STRIP_WS2811_SLOT_NS	1250
+#define LED_STRIP_WS2811_TOL_NS		150
+#define LED_STRIP_WS2811_T0L_MIN_NS	850			// 1000
+#define LED_STRIP_WS2811_T1L_MIN_NS	500			// 650
+#define LED_STRIP_WS2811_SLOT_MIN_NS	1100
+#define LED_STRIP_WS2811_ORDER		LED_STRIP_RGB
+
+#define LED_STRIP_SK6812_T0H_NS		300
+#define LED_STRIP_SK6812_T1H_NS		600
+#define LED_STRIP_SK6812_SLOT_NS	1250
+#define LED_STRIP_SK6812_TOL_NS		150
+#define LED_STRIP_SK6812_T0L_MIN_NS	750			// 900
+#define LED_STRIP_SK6812_T1L_MIN_NS	450			// 600
+#define LED_STRIP_SK6812_SLOT_MIN_NS	1100
+#define LED_STRIP_SK6812_ORDER		LED_STRIP_GRB
+
+#ifndef LED_STRIP_CHIP
+#define LED_STRIP_CHIP				LED_STRIP_POLOLU
+#endif
+
+// the chosen profile, ledstripconf.h may set any of these itself
+#if LED_STRIP_CHIP == LED_STRIP_POLOLU
+#define LED_STRIP_CHIP_(name)		LED_STRIP_POLOLU_##name
+#elif LED_STRIP_CHIP == LED_STRIP_WS2812
+#define LED_STRIP_CHIP_(name)		LED_STRIP_WS2812_##name
+#elif LED_STRIP_CHIP == LED_STRIP_WS2811
+#define LED_STRIP_CHIP_(name)		LED_STRIP_WS2811_##name
+#elif LED_STRIP_CHIP == LED_STRIP_SK6812 || LED_STRIP_CHIP == LED_STRIP_SK6812_RGBW
+#define LED_STRIP_CHIP_(name)		LED_STRIP_SK6812_##name
+#else
+#error "Unknown LED_STRIP_CHIP"
+#endif
+
+#ifndef LED_STRIP_T0H_NS
+#define LED_STRIP_T0H_NS			LED_STRIP_CHIP_(T0H_NS)
+#endif
+#ifndef LED_STRIP_T1H_NS
+#define LED_STRIP_T1H_NS			LED_STRIP_CHIP_(T1H_NS)
+#endif
+#ifndef LED_STRIP_SLOT_NS
+#define LED_STRIP_SLOT_NS			LED_STRIP_CHIP_(SLOT_NS)
+#endif
+#ifndef LED_STRIP_TOL_NS
+#define LED_STRIP_TOL_NS			LED_STRIP_CHIP_(TOL_NS)
+#endif
+#ifndef LED_STRIP_T0L_MIN_NS
+#define LED_STRIP_T0L_MIN_NS		LED_STRIP_CHIP_(T0L_MIN_NS)
+#endif
+#ifndef LED_STRIP_T1L_MIN_NS
+#define LED_STRIP_T1L_MIN_NS		LED_STRIP_CHIP_(T1L_MIN_NS)
+#endif
+#ifndef LED_STRIP_SLOT_MIN_NS
+#define LED_STRIP_SLOT_MIN_NS		LED_STRIP_CHIP_(SLOT_MIN_NS)
+#endif
+#ifndef LED_STRIP_ORDER
+#define LED_STRIP_ORDER				LED_STRIP_CHIP_(ORDER)
+#endif
+#if LED_STRIP_CHIP == LED_STRIP_SK6812_RGBW
+#define LED_STRIP_BYTES				4
+#else
+#define LED_STRIP_BYTES				3
+#endif
+
+// Whole cycles of an f Hz clock nearest to ns, and back. f is taken to the
+// kHz so f * ns stays within 32 bits for the asm operands.
+#define LED_STRIP_CYCLES(f, ns)		((((f) / 1000UL) * (ns) + 500000UL) / 1000000UL)
+#define LED_STRIP_NS(f, cycles)		(((cycles) * 1000000UL + (f) / 2000UL) / ((f) / 1000UL))
+#define LED_STRIP_MAX(a, b)			((a) > (b) ? (a) : (b))
+
+// 1 if cycles of an f Hz clock miss ns by more than tol
+#define LED_STRIP_MISSES(f, cycles, ns, tol)	\
+	(LED_STRIP_NS(f, cycles) + (tol) < (ns) || LED_STRIP_NS(f, cycles) > (ns) + (tol))
+
+// 1 if a slot of slot cycles, high for high0 cycles for a 0 and high1 for a 1,
+// leaves a low time or the slot shorter than the minimums t0l, t1l and min ns
+#define LED_STRIP_SHORT(f, high0, high1, slot, t0l, t1l, min)	\
+	(LED_STRIP_NS(f, (slot) - (high0)) < (t0l) || LED_STRIP_NS(f, (slot) - (high1)) < (t1l) ||	\
+	 LED_STRIP_NS(f, slot) < (min))
+
+// Bit-banged slot of led_strip_output(), cycles from the end of the sbi:
+//   rol, sbi, T0 nops, brcs, cbi (0 falls), T1 nops, brcc, cbi (1 falls),
+//   TL nops, ret, rcall of the next bit
+// A 0 is high T0 + 3 cycles, a 1 T0 + T1 + 5, both slots take
+// T0 + T1 + TL + 15. The slot ending a byte is 12 cycles longer.
+#define LED_STRIP_BIT_T0H(f, t0h)			LED_STRIP_MAX(LED_STRIP_CYCLES(f, t0h), 3)
+#define LED_STRIP_BIT_T1H(f, t0h, t1h)		LED_STRIP_MAX(LED_STRIP_CYCLES(f, t1h), LED_STRIP_BIT_T0H(f, t0h) + 2)
+#define LED_STRIP_BIT_T0_NOPS(f, t0h)		(LED_STRIP_BIT_T0H(f, t0h) - 3)
+#define LED_STRIP_BIT_T1_NOPS(f, t0h, t1h)	(LED_STRIP_BIT_T1H(f, t0h, t1h) - LED_STRIP_BIT_T0H(f, t0h) - 2)
+#define LED_STRIP_BIT_TL_NOPS(f, t0h, t1h, slot)	\
+	(LED_STRIP_MAX(LED_STRIP_CYCLES(f, slot), LED_STRIP_BIT_T1H(f, t0h, t1h) + 10) - LED_STRIP_BIT_T1H(f, t0h, t1h) - 10)
+#define LED_STRIP_BIT_SLOT(f, t0h, t1h, slot)	\
+	(LED_STRIP_BIT_T0_NOPS(f, t0h) + LED_STRIP_BIT_T1_NOPS(f, t0h, t1h) + LED_STRIP_BIT_TL_NOPS(f, t0h, t1h, slot) + 15)
+
+// Parallel slot of LED_STRIP_PARALLEL, out instructions of one cycle:
+//   out all high, T0 nops, out (0s fall), T1 nops, out (1s fall), dec, brne,
+//   16 cycles shifting the next bits of the strips in
+// The slot takes T0 + T1 + 22 cycles, longer between LEDs.
+#define LED_STRIP_PAR_T0H(f, t0h)			LED_STRIP_MAX(LED_STRIP_CYCLES(f, t0h), 1)
+#define LED_STRIP_PAR_T1H(f, t0h, t1h)		LED_STRIP_MAX(LED_STRIP_CYCLES(f, t1h), LED_STRIP_PAR_T0H(f, t0h) + 1)
+#define LED_STRIP_PAR_T0_NOPS(f, t0h)		(LED_STRIP_PAR_T0H(f, t0h) - 1)
+#define LED_STRIP_PAR_T1_NOPS(f, t0h, t1h)	(LED_STRIP_PAR_T1H(f, t0h, t1h) - LED_STRIP_PAR_T0H(f, t0h) - 1)
+#define LED_STRIP_PAR_SLOT(f, t0h, t1h)		(LED_STRIP_PAR_T0_NOPS(f, t0h) + LED_STRIP_PAR_T1_NOPS(f, t0h, t1h) + 22)
+
+// USART slot of LED_STRIP_USART, 4 pattern bits of 2 * half cycles each, a 0
+// high for one, a 1 for ones (3 or 2); the shortest half that makes both high
+// times, both low times (three and 4 - ones pattern bits) and the slot long
+// enough
+#define LED_STRIP_USART_NS_MIN(ones, t0h, t1h, tol, t0l, t1l, min)	\
+	LED_STRIP_MAX(LED_STRIP_MAX((t0h) - (tol), ((t1h) - (tol) + (ones) - 1) / (ones)),	\
+		LED_STRIP_MAX(LED_STRIP_MAX(((t0l) + 2) / 3, ((t1l) + 3 - (ones)) / (4 - (ones))), ((min) + 3) / 4))
+#define LED_STRIP_USART_HALF(f, ones, t0h, t1h, tol, t0l, t1l, min)	\
+	((((f) / 2000UL) * LED_STRIP_USART_NS_MIN(ones, t0h, t1h, tol, t0l, t1l, min) + 999999UL) / 1000000UL)
+
+// 1 if that slot meets the high times, the low times and the slot of the chip
+#define LED_STRIP_USART_FITS(f, half, ones, t0h, t1h, tol, t0l, t1l, min)	\
+	((half) >= 1 && !LED_STRIP_MISSES(f, 2 * (half), t0h, tol) &&	\
+	 !LED_STRIP_MISSES(f, 2 * (ones) * (half), t1h, tol) &&	\
+	 !LED_STRIP_SHORT(f, 2 * (half), 2 * (ones) * (half), 8 * (half), t0l, t1l, min))
+
+#endif
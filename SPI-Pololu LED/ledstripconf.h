@@ -0,0 +1,68 @@
+//*****************************************************************************
+// File Name	: ledstripconf.h
+// Title		: Pololu LED strip output configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef LEDSTRIPCONF_H
+#define LEDSTRIPCONF_H
+
+// Strip data line, port letter and bit (pin.h)
+#define LED_STRIP_DATA				D, 7
+
+// Timing profile of the LEDs on the strip (ledstripchip.h): LED_STRIP_POLOLU,
+// LED_STRIP_WS2812, LED_STRIP_WS2811, LED_STRIP_SK6812 or LED_STRIP_SK6812_RGBW,
+// or pass e.g. -DLED_STRIP_CHIP=LED_STRIP_WS2812. The bit timing is worked out
+// from F_CPU for every output. LED_STRIP_T0H_NS and LED_STRIP_T1H_NS defined
+// here override the high times of the profile.
+#ifndef LED_STRIP_CHIP
+#define LED_STRIP_CHIP				LED_STRIP_POLOLU
+#endif
+
+// Comment out to send colors linearly instead of through the gamma table
+#define LED_STRIP_GAMMA
+
+// Uncomment to dither in time, or pass -DLED_STRIP_DITHER. Gamma and brightness
+// are worked out in 12 bits and what does not fit the 8 bits sent is carried
+// to the next refresh of the LED, so low levels and dim fades get 16 times the
+// steps. Costs 2 bytes of SRAM per LED and about 80 cycles between LEDs; the
+// controller then refreshes the strip every LED_STRIP_DITHER_MS even when
+// nothing changes, so the fractions average out. Not with LED_STRIP_PARALLEL.
+//#define LED_STRIP_DITHER
+#define LED_STRIP_DITHER_LEDS		21			// LEDs with their own residues
+#define LED_STRIP_DITHER_MS			10
+
+// Uncomment to shift the waveform out of the USART in master SPI mode on TXD
+// (PD1) instead of bit-banging LED_STRIP_DATA, or pass -DLED_STRIP_USART.
+// Needs an ATmega48/88/168, the ATmega8 USART has no master SPI mode.
+//#define LED_STRIP_USART
+
+// Width of one pattern bit, a strip 0 is high for one and a 1 for three of them,
+// or two of them where three can not meet the low time of a 1. By default the
+// shortest the USART can do that meets both high times, both low times and the
+// slot of LED_STRIP_CHIP, for the Pololu profile 500 ns (two) at 8 MHz, 333 ns
+// at 12 MHz, 300 ns at 20 MHz. Uncomment to set it, rounded to what the USART
+// can do; the build stops with an #error if it misses the chip.
+//#define LED_STRIP_USART_NS			300
+
+// Uncomment to drive this many strips (up to 8) at the same time from
+// LED_STRIP_PARALLEL_PORT, strip i on pin 7 - i, or pass -DLED_STRIP_PARALLEL=8.
+// The LED buffer is cut into equal runs, one per strip. The strips take the
+// whole port over, its other pins can not be used.
+//#define LED_STRIP_PARALLEL			8
+#define LED_STRIP_PARALLEL_PORT		PORTD
+#define LED_STRIP_PARALLEL_DDR		DDRD
+
+// Uncomment to serve interrupts between LEDs instead of blocking them for
+// the whole strip, or pass -DLED_STRIP_CHUNKED
+//#define LED_STRIP_CHUNKED
+
+// The strip latches when the data line stays low this long. In chunked mode
+// every interrupt handler that can run between two LEDs has to finish well
+// within it. 50 us for WS2812B based strips, the older TM1804 strips latch
+// much sooner and can not be used with LED_STRIP_CHUNKED.
+#define LED_STRIP_LATCH_US			50
+
+#endif
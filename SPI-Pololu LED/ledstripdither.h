@@ -0,0 +1,38 @@
+//*****************************************************************************
+// File Name	: ledstripdither.h
+// Title		: LED strip dither arithmetic
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// With LED_STRIP_DITHER a color byte becomes a 12 bit level, from the gamma
+// table or LED_STRIP_DITHER_LINEAR(), which is scaled by the brightness. The
+// top 8 bits are sent and the 4 below are the residue carried to the next
+// refresh of the same LED. An unscaled level without the gamma table is an
+// exact multiple of 16, so a plain color is sent as it is and never flickers.
+// Kept apart from ledstrip.c so host/dither.c can check it.
+//*****************************************************************************
+
+#ifndef ledstripdither_h
+#define ledstripdither_h
+
+//----- Defines ---------------------------------------------------------------
+// 12 bit level of a color byte without the gamma table, 255 is 4080
+#define LED_STRIP_DITHER_LINEAR(value)	((unsigned int)(value) << 4)
+
+//----- Functions ---------------------------------------------------------------
+
+// led_strip_dither()
+//     scales the 12 bit level by scale / 256, scale is brightness + 1, adds
+//     the residue of the last refresh and returns the top 8 bits, the rest
+//     goes back into *residue. Keeps every product in 16 bits, about 25 cycles.
+static inline unsigned char led_strip_dither(unsigned int level, unsigned int scale, unsigned char * residue)
+{
+	level = (((level >> 4) * scale) + (((level & 0x0F) * scale) >> 4)) >> 4;
+	level += *residue;
+	if (level > 4095)
+		level = 4095;
+	*residue = level & 0x0F;
+	return level >> 4;
+}
+
+#endif
@@ -0,0 +1,157 @@
+//*****************************************************************************
+// File Name	: persist.c
+// Title		: Wear levelled records in EEPROM
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "hal.h"				// include EEPROM access
+#include "crc8.h"
+#include "persist.h"
+
+//----- Defines ---------------------------------------------------------------
+#define PERSIST_HEADER				3			// seq and crc
+#define PERSIST_ERASED				0xFFFF		// seq of a slot never written
+
+//----- Global Variables -------------------------------------------------------
+static unsigned char HAL_EEPROM persist_eeprom[PERSIST_EEPROM_SIZE];
+
+static unsigned char persist_size;					// record size
+static unsigned char persist_slots;
+static unsigned char persist_current = 0;			// slot of the current record
+static unsigned short persist_seq = 0;				// its sequence number
+static unsigned char persist_valid = 0;				// there is a current record
+
+// the save being written
+static const unsigned char* persist_data;
+static unsigned char persist_slot;
+static unsigned short persist_next;				// its sequence number
+static unsigned char persist_pos;					// next byte of the slot
+static unsigned char persist_crc;
+static unsigned char persist_writing = 0;
+
+//----- Functions --------------------------------------------------------------
+
+static unsigned char* persistSlot(unsigned char slot)
+{
+	return &persist_eeprom[(unsigned int)slot * (persist_size + PERSIST_HEADER)];
+}
+
+// byte pos of the slot image of a save: seq low, seq high, data, crc
+static unsigned char persistByte(unsigned char pos)
+{
+	if (pos == 0)
+		return persist_next & 0xFF;
+	if (pos == 1)
+		return persist_next >> 8;
+	return persist_data[pos - 2];
+}
+
+void persistInit(unsigned char size)
+{
+	unsigned char* slot;
+	unsigned short seq;
+	unsigned char crc, byte;
+	unsigned char i, pos;
+
+	persist_size = size;
+	persist_slots = PERSIST_EEPROM_SIZE / (size + PERSIST_HEADER);
+	persist_valid = 0;
+	persist_writing = 0;
+
+	for(i=0;i<persist_slots;i++)
+	{
+		slot = persistSlot(i);
+		crc = crc8Update(0, size);
+		for(pos=0;pos<size + 2;pos++)
+		{
+			halEepromRead(&byte, slot + pos, 1);
+			crc = crc8Update(crc, byte);
+		}
+		halEepromRead(&byte, slot + pos, 1);
+		if (byte != (unsigned char)~crc)
+			continue;
+
+		halEepromRead(&seq, slot, 2);
+		if (seq == PERSIST_ERASED)
+			continue;
+		if (!persist_valid || (short)(seq - persist_seq) > 0)
+		{
+			persist_current = i;
+			persist_seq = seq;
+			persist_valid = 1;
+		}
+	}
+}
+
+unsigned char persistLoad(void* data)
+{
+	if (!persist_valid)
+		return 0;
+	halEepromRead(data, persistSlot(persist_current) + 2, persist_size);
+	return 1;
+}
+
+void persistSave(const void* data)
+{
+	const unsigned char* d = data;
+	unsigned char* slot = persistSlot(persist_current) + 2;
+	unsigned char byte;
+	unsigned char i;
+
+	if (persist_valid)
+	{
+		for(i=0;i<persist_size;i++)
+		{
+			halEepromRead(&byte, slot + i, 1);
+			if (byte != d[i])
+				break;
+		}
+		if (i == persist_size)
+		{
+			// a save cut short leaves a slot that fails its crc
+			persist_writing = 0;
+			return;
+		}
+	}
+
+	// a save being written starts over in the same slot
+	if (!persist_writing)
+		persist_slot = persist_valid ? (persist_current + 1) % persist_slots : 0;
+	persist_next = persist_seq + 1;
+	if (persist_next == PERSIST_ERASED)
+		persist_next = 0;
+	persist_data = d;
+	persist_pos = 0;
+	persist_crc = crc8Update(0, persist_size);
+	persist_writing = 1;
+}
+
+unsigned char persistPoll(void)
+{
+	unsigned char* slot;
+	unsigned char byte;
+
+	if (!persist_writing || !halEepromReady())
+		return persist_writing;
+
+	slot = persistSlot(persist_slot);
+	if (persist_pos < persist_size + 2)
+	{
+		byte = persistByte(persist_pos);
+		persist_crc = crc8Update(persist_crc, byte);
+		halEepromWrite(slot + persist_pos, byte);
+		persist_pos++;
+		return 1;
+	}
+
+	// the crc goes last, the slot only counts once it is written
+	halEepromWrite(slot + persist_pos, ~persist_crc);
+	persist_current = persist_slot;
+	persist_seq = persist_next;
+	persist_valid = 1;
+	persist_writing = 0;
+	return 0;
+}
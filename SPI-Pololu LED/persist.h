@@ -0,0 +1,51 @@
+//*****************************************************************************
+// File Name	: persist.h
+// Title		: Wear levelled records in EEPROM
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Keeps one record of a fixed size across resets. The EEPROM is cut into
+// slots of the record plus a header:
+//
+//   seq   (2 bytes) record sequence number, the highest valid one is current
+//   data            the record
+//   crc   (1 byte)  inverted crc8 (crc8.h) of size, seq and data
+//
+// Each save goes to the slot after the current one, so wear is spread over
+// all slots, and bytes that do not change are not written at all. A save is
+// written behind the main loop, one byte per persistPoll() whenever the
+// EEPROM is ready, instead of blocking for the 3.4 to 8.5 ms every byte
+// takes. A slot whose write was cut short by a reset fails its crc and the
+// previous record stays current. A record saved by a firmware with another
+// record size fails it too.
+//*****************************************************************************
+
+#ifndef persist_h
+#define persist_h
+
+//----- Include Files ---------------------------------------------------------
+#include "persistconf.h"
+
+//----- Functions ---------------------------------------------------------------
+
+// persistInit()
+//     sets the record size and finds the current record
+void persistInit(unsigned char size);
+
+// persistLoad()
+//     copies the current record into data
+//     returns 0 if there is none
+unsigned char persistLoad(void* data);
+
+// persistSave()
+//     makes data the next record, written by persistPoll(). data must not
+//     change until it is written, saving again starts over with the new data.
+//     Data equal to the current record is not written.
+void persistSave(const void* data);
+
+// persistPoll()
+//     writes the next byte of a save if the EEPROM is ready
+//     returns 1 while a save is being written
+unsigned char persistPoll(void);
+
+#endif
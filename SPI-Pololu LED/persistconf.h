@@ -0,0 +1,33 @@
+//*****************************************************************************
+// File Name	: persistconf.h
+// Title		: Persisted LED state configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef PERSISTCONF_H
+#define PERSISTCONF_H
+
+// EEPROM bytes given to the records, 512 is all of it on the ATmega8 and
+// ATmega88. Every record takes its size plus 3 bytes and they are written in
+// turn, so each cell only sees every n-th save.
+#define PERSIST_EEPROM_SIZE			512
+
+// Uncomment to keep the whole frame shown instead of only its first LED, or
+// pass -DPERSIST_FRAME. Nearly doubles the record, so about half as many
+// slots.
+//#define PERSIST_FRAME
+
+// The state is saved this long after the last command that changed it, so a
+// stream of frames or a fade being set up costs one record, not one per step
+#define PERSIST_DELAY_MS			2000
+
+// and no sooner than this after the previous save. The record of the
+// controller takes 79 bytes, 6 slots, so each cell is written every 6th save:
+// at 100 000 cycles that is 600 000 saves, about 5.7 years of a host that
+// changes the state all the time (2.9 years with PERSIST_FRAME, 3 slots). A
+// change is lost if power goes before its save, up to this long after it.
+#define PERSIST_MIN_INTERVAL_S		300
+
+#endif
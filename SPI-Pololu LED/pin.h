@@ -0,0 +1,59 @@
+//*****************************************************************************
+// File Name	: pin.h
+// Title		: Compile time I/O pins
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// A pin is named once, in a conf header, as its port letter and bit:
+//
+//     #define DALLAS_BUS				C, 1
+//
+// and PIN_DEFINE() makes inline functions for that pin out of the name:
+//
+//     PIN_DEFINE(dallasBus, DALLAS_BUS)
+//
+//     dallasBusOutput();			// sbi DDRC, 1
+//     dallasBusLow();				// cbi PORTC, 1
+//     if (dallasBusRead())			// sbis PINC, 1
+//
+// Port and bit are constants in every function, so each one is the single
+// instruction and a driver bound to several pins, one PIN_DEFINE() each, costs
+// nothing at run time. The ports of the ATmega8 and ATmega48/88/168 are all
+// within reach of sbi, cbi, sbis and sbic. PIN_DEFINE() is used at file scope
+// without a semicolon. Both firmwares carry the same copy of this file.
+//*****************************************************************************
+
+#ifndef pin_h
+#define pin_h
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+
+//----- Defines ---------------------------------------------------------------
+// registers and bit of a pin, for masks and asm operands
+#define PIN_PORT(pin)				PIN_PORT_(pin)
+#define PIN_DDR(pin)				PIN_DDR_(pin)
+#define PIN_IN(pin)					PIN_IN_(pin)
+#define PIN_BIT(pin)				PIN_BIT_(pin)
+#define PIN_MASK(pin)				(1 << PIN_BIT(pin))
+
+#define PIN_PORT_(port, bit)		PORT##port
+#define PIN_DDR_(port, bit)			DDR##port
+#define PIN_IN_(port, bit)			PIN##port
+#define PIN_BIT_(port, bit)			(bit)
+
+// name##High(), name##Low(), name##Write(level)    drive the output
+// name##Output(), name##Input()                     direction, an input pulled
+//                                                   up by High() and floating by Low()
+// name##Read()                                      nonzero if the pin is high
+#define PIN_DEFINE(name, pin)		PIN_DEFINE_(name, pin)
+#define PIN_DEFINE_(name, port, bit)	\
+	static inline __attribute__((always_inline)) void name##High(void) { PORT##port |= (1 << (bit)); }	\
+	static inline __attribute__((always_inline)) void name##Low(void) { PORT##port &= ~(1 << (bit)); }	\
+	static inline __attribute__((always_inline)) void name##Write(unsigned char level)	\
+		{ if (level) PORT##port |= (1 << (bit)); else PORT##port &= ~(1 << (bit)); }	\
+	static inline __attribute__((always_inline)) void name##Output(void) { DDR##port |= (1 << (bit)); }	\
+	static inline __attribute__((always_inline)) void name##Input(void) { DDR##port &= ~(1 << (bit)); }	\
+	static inline __attribute__((always_inline)) unsigned char name##Read(void) { return PIN##port & (1 << (bit)); }
+
+#endif
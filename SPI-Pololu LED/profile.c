@@ -0,0 +1,72 @@
+//*****************************************************************************
+// File Name	: profile.c
+// Title		: Section cycle profiler
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include <string.h>				// include string support
+#include "profile.h"
+
+#ifdef PROFILE_ENABLE
+
+//----- Global Variables -------------------------------------------------------
+static profile_entry_T profile_table[PROFILE_SECTIONS];
+static unsigned long profile_overhead = 0;	// cycles spent in the macros themselves
+
+//----- Functions --------------------------------------------------------------
+
+void profileInit(void)
+{
+	unsigned char i;
+	unsigned long start;
+
+	memset(profile_table, 0, sizeof(profile_table));
+	for(i=0;i<PROFILE_SECTIONS;i++)
+		profile_table[i].min = 0xFFFFFFFF;
+
+	start = systimeCycles();
+	profile_overhead = systimeCycles() - start;
+}
+
+void profileRecord(unsigned char section, unsigned long cycles)
+{
+	unsigned char sreg = SREG;
+	profile_entry_T* entry = &profile_table[section];
+
+	if (cycles > profile_overhead)
+		cycles -= profile_overhead;
+	else
+		cycles = 0;
+
+	// the table is also updated from interrupts
+	cli();
+	// halve both instead of wrapping, the average stays right
+	while (entry->count == 0xFFFF || entry->total > 0xFFFFFFFF - cycles)
+	{
+		entry->total >>= 1;
+		entry->count >>= 1;
+	}
+	entry->total += cycles;
+	entry->count++;
+	if (cycles < entry->min)
+		entry->min = cycles;
+	if (cycles > entry->max)
+		entry->max = cycles;
+	SREG = sreg;
+}
+
+void profileRead(unsigned char section, profile_entry_T* entry)
+{
+	unsigned char sreg = SREG;
+
+	cli();
+	*entry = profile_table[section];
+	SREG = sreg;
+}
+
+#endif
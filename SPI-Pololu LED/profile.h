@@ -0,0 +1,63 @@
+//*****************************************************************************
+// File Name	: profile.h
+// Title		: Section cycle profiler
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Wrap a hot path in PROFILE_ENTER(section) / PROFILE_EXIT(section) to keep
+// min/max/total cycle counts for it, measured with the systime cycle clock.
+// The sections are listed in profileconf.h. Unless PROFILE_ENABLE is defined
+// the macros compile to nothing.
+//*****************************************************************************
+
+#ifndef profile_h
+#define profile_h
+
+//----- Include Files ---------------------------------------------------------
+#include "profileconf.h"
+
+#ifdef PROFILE_ENABLE
+
+#include "systime.h"
+
+//----- Typedefs --------------------------------------------------------------
+
+// one row of the profile table, all counts are in cpu cycles
+// with the cost of the PROFILE_ENTER/EXIT pair removed; total and count
+// are halved together before either would overflow, so total / count
+// stays the average while min and max cover the whole run
+typedef struct profile_entry_S
+{
+	unsigned long total;
+	unsigned long min;
+	unsigned long max;
+	unsigned short count;
+} profile_entry_T;
+
+//----- Defines ---------------------------------------------------------------
+#define PROFILE_ENTER(section)		unsigned long profile_start_##section = systimeCycles()
+#define PROFILE_EXIT(section)		profileRecord(section, systimeCycles() - profile_start_##section)
+
+//----- Functions ---------------------------------------------------------------
+
+// profileInit()
+//     clears the table and measures the ENTER/EXIT overhead
+//     systimeInit() must have been called first
+void profileInit(void);
+
+// profileRecord()
+//     adds one measurement to the given section, used by PROFILE_EXIT
+void profileRecord(unsigned char section, unsigned long cycles);
+
+// profileRead()
+//     copies the given section out of the table without tearing
+void profileRead(unsigned char section, profile_entry_T* entry);
+
+#else
+
+#define PROFILE_ENTER(section)
+#define PROFILE_EXIT(section)
+
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+//*****************************************************************************
+// File Name	: profileconf.h
+// Title		: Section cycle profiler configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef PROFILECONF_H
+#define PROFILECONF_H
+
+// Uncomment to build the profiler in, or pass -DPROFILE_ENABLE
+//#define PROFILE_ENABLE
+
+// Profiled sections, each one is a row in the profile table
+#define PROFILE_STRIP_WRITE			0			// led_strip_write()
+#define PROFILE_SPI_ISR				1			// SPI_STC_vect
+#define PROFILE_SECTIONS			2
+
+#endif
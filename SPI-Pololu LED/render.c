@@ -0,0 +1,140 @@
+//*****************************************************************************
+// File Name	: render.c
+// Title		: Procedural strip rendering
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "render.h"
+
+#if RENDER_LEDS < 3
+#error "RENDER_LEDS must be at least 3"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+static unsigned char render_mode = RENDER_OFF;
+static unsigned char render_step = 0;
+static unsigned char render_speed = 0;
+static unsigned char render_phase = 0;				// sweep phase of the first LED
+static rgb_color render_low;
+static rgb_color render_high;
+static render_segment_T render_segment[RENDER_SEGMENT_MAX];
+static unsigned char render_segments = 0;
+
+// state of the frame being sent
+static unsigned short render_acc[3];				// gradient color, 8.8 fixed point
+static short render_inc[3];							// gradient change per LED, 8.8
+static short render_diff[3];						// high minus low color
+static unsigned char render_pos;					// sweep phase of the next LED
+static unsigned char render_seg;					// current segment
+static unsigned char render_left;					// LEDs left in it
+
+//----- Functions --------------------------------------------------------------
+
+static void renderNext(rgb_color* color)
+{
+	unsigned char t;
+
+	switch (render_mode)
+	{
+	case RENDER_GRADIENT:
+		color->red = render_acc[0] >> 8;
+		color->green = render_acc[1] >> 8;
+		color->blue = render_acc[2] >> 8;
+		render_acc[0] += render_inc[0];
+		render_acc[1] += render_inc[1];
+		render_acc[2] += render_inc[2];
+		break;
+	case RENDER_SEGMENTS:
+		if (render_segments == 0)
+		{
+			*color = (rgb_color){ 0, 0, 0 };
+			break;
+		}
+		if (render_left == 0)
+		{
+			if (++render_seg >= render_segments)
+				render_seg = 0;
+			render_left = render_segment[render_seg].length;
+		}
+		render_left--;
+		*color = render_segment[render_seg].color;
+		break;
+	case RENDER_SWEEP:
+		// triangle wave 0..127..0 over one period
+		t = (render_pos & 0x80) ? 255 - render_pos : render_pos;
+		color->red = render_low.red + ((render_diff[0] * t) >> 7);
+		color->green = render_low.green + ((render_diff[1] * t) >> 7);
+		color->blue = render_low.blue + ((render_diff[2] * t) >> 7);
+		render_pos += render_step;
+		break;
+	default:
+		*color = render_low;
+	}
+}
+
+void renderMode(unsigned char mode, unsigned char step, unsigned char speed)
+{
+	render_mode = mode;
+	render_step = step;
+	render_speed = speed;
+}
+
+unsigned char renderActive(void)
+{
+	return render_mode;
+}
+
+void renderColors(rgb_color* low, rgb_color* high)
+{
+	render_low = *low;
+	render_high = *high;
+}
+
+unsigned char renderSegment(unsigned char length, rgb_color* color)
+{
+	if (length == 0)
+	{
+		render_segments = 0;
+		return 1;
+	}
+	if (render_segments >= RENDER_SEGMENT_MAX)
+		return 0;
+
+	render_segment[render_segments].length = length;
+	render_segment[render_segments].color = *color;
+	render_segments++;
+	return 1;
+}
+
+unsigned char renderSegments(render_segment_T* segments)
+{
+	unsigned char i;
+
+	for(i=0;i<render_segments;i++)
+		segments[i] = render_segment[i];
+	return render_segments;
+}
+
+void renderFrame(void)
+{
+	unsigned char* low = &render_low.red;
+	unsigned char* high = &render_high.red;
+	unsigned char i;
+
+	for(i=0;i<3;i++)
+	{
+		render_diff[i] = high[i] - low[i];
+		render_acc[i] = ((unsigned short)low[i] << 8) | 0x80;
+		render_inc[i] = ((long)render_diff[i] << 8) / (RENDER_LEDS - 1);
+	}
+	render_pos = render_phase;
+	render_seg = render_segments - 1;
+	render_left = 0;
+
+	led_strip_generate(renderNext, RENDER_LEDS);
+
+	render_phase += render_speed;
+}
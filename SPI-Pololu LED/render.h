@@ -0,0 +1,69 @@
+//*****************************************************************************
+// File Name	: render.h
+// Title		: Procedural strip rendering
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Renders frames without a frame buffer: each LED color is computed by a
+// generator called from the strip writer between two LEDs, see
+// led_strip_generate(). Per LED the generators only add and shift, the
+// divisions are done once per frame. Modes:
+//
+//   RENDER_SOLID     every LED in the low color
+//   RENDER_GRADIENT  low color on the first LED to high color on the last
+//   RENDER_SEGMENTS  the segment list, repeated along the strip
+//   RENDER_SWEEP     a triangle wave between low and high color, step is the
+//                    phase change per LED, speed per frame (256 is a period)
+//*****************************************************************************
+
+#ifndef render_h
+#define render_h
+
+//----- Include Files ---------------------------------------------------------
+#include "renderconf.h"
+#include "ledstrip.h"
+
+//----- Defines ---------------------------------------------------------------
+#define RENDER_OFF					0			// the strip shows the LED buffers
+#define RENDER_SOLID				1
+#define RENDER_GRADIENT				2
+#define RENDER_SEGMENTS				3
+#define RENDER_SWEEP				4
+
+//----- Typedefs --------------------------------------------------------------
+
+typedef struct render_segment_S
+{
+	unsigned char length;			// LEDs, never 0
+	rgb_color color;
+} render_segment_T;
+
+//----- Functions ---------------------------------------------------------------
+
+// renderMode()
+//     selects the mode, step and speed are used by RENDER_SWEEP
+void renderMode(unsigned char mode, unsigned char step, unsigned char speed);
+
+// renderActive()
+//     returns the current mode, RENDER_OFF if not rendering
+unsigned char renderActive(void);
+
+// renderColors()
+//     sets the low and high colors
+void renderColors(rgb_color* low, rgb_color* high);
+
+// renderSegment()
+//     appends a segment to the list, length 0 clears the list
+//     returns 0 if the list is full
+unsigned char renderSegment(unsigned char length, rgb_color* color);
+
+// renderSegments()
+//     copies the segment list into segments, RENDER_SEGMENT_MAX at most
+//     returns its length
+unsigned char renderSegments(render_segment_T* segments);
+
+// renderFrame()
+//     sends one frame of RENDER_LEDS colors and advances the sweep phase
+void renderFrame(void);
+
+#endif
@@ -0,0 +1,22 @@
+//*****************************************************************************
+// File Name	: renderconf.h
+// Title		: Procedural strip rendering configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef RENDERCONF_H
+#define RENDERCONF_H
+
+// LEDs sent per rendered frame. Nothing is buffered per LED, so this is only
+// limited by the frame time: about 55 us per LED at 8 MHz.
+#define RENDER_LEDS					21
+
+// Entries in the segment list
+#define RENDER_SEGMENT_MAX			8
+
+// Time between rendered frames
+#define RENDER_FRAME_MS				20
+
+#endif
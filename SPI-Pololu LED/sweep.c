@@ -0,0 +1,177 @@
+//*****************************************************************************
+// File Name	: sweep.c
+// Title		: Color sweep
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include "sweep.h"
+
+#if SWEEP_STOPS < 2
+#error "SWEEP_STOPS must be at least 2"
+#endif
+
+//----- Global Variables -------------------------------------------------------
+static rgb_color sweep_stop[SWEEP_STOPS] = { {250, 20, 5}, {100, 0, 250} };
+static unsigned char sweep_count = 2;				// stops in use
+static unsigned char sweep_divider = 1;
+static unsigned char sweep_easing = SWEEP_LINEAR;
+
+// the leg being swept
+static unsigned char sweep_from = 0;
+static unsigned char sweep_to = 0;
+static signed char sweep_dir = 1;
+static unsigned short sweep_left = 0;				// steps left, 0 starts the next leg
+static unsigned short sweep_acc[3];					// linear color, 8.8 fixed point
+static unsigned short sweep_inc[3];					// linear change per step, 8.8 modulo 2^16
+static short sweep_diff[3];							// eased, to minus from
+static unsigned short sweep_phase;					// eased, 0.16 fixed point
+static unsigned short sweep_dphase;
+static rgb_color sweep_last;
+static unsigned char sweep_first = 1;				// next leg is the first of the sweep
+
+//----- Functions --------------------------------------------------------------
+
+static unsigned char sweepEase(unsigned char t)
+{
+	unsigned char s;
+
+	switch (sweep_easing)
+	{
+	case SWEEP_EASE_IN:
+		return ((unsigned int)t * t) >> 8;
+	case SWEEP_EASE_OUT:
+		s = 255 - t;
+		return 255 - (((unsigned int)s * s) >> 8);
+	case SWEEP_EASE_IN_OUT:
+		// 3t^2 - 2t^3, scaled to stay within 16 bits
+		s = ((unsigned int)t * t) >> 8;
+		return ((unsigned int)s * ((765 - 2 * t) >> 2)) >> 6;
+	default:
+		return t;
+	}
+}
+
+static void sweepLeg(void)
+{
+	unsigned char* from = &sweep_stop[sweep_from].red;
+	unsigned char* to = &sweep_stop[sweep_to].red;
+	unsigned char size = 0;
+	unsigned char i;
+	short diff;
+
+	for(i=0;i<3;i++)
+	{
+		diff = to[i] - from[i];
+		if (diff > size)
+			size = diff;
+		if (-diff > size)
+			size = -diff;
+	}
+	sweep_left = size / sweep_divider;
+	if (sweep_left == 0)
+		sweep_left = 1;
+
+	for(i=0;i<3;i++)
+	{
+		sweep_diff[i] = to[i] - from[i];
+		sweep_acc[i] = ((unsigned short)from[i] << 8) | 0x80;
+		sweep_inc[i] = ((long)sweep_diff[i] << 8) / sweep_left;
+	}
+	sweep_phase = 0;
+	sweep_dphase = 0xFFFF / sweep_left;
+}
+
+static void sweepRestart(void)
+{
+	sweep_from = 0;
+	sweep_to = 0;
+	sweep_dir = 1;
+	sweep_left = 0;
+	sweep_first = 1;
+}
+
+void sweepStop(unsigned char index, unsigned char count, rgb_color* color)
+{
+	if (index >= SWEEP_STOPS)
+		return;
+	if (count > SWEEP_STOPS)
+		count = SWEEP_STOPS;
+	if (count < 1)
+		count = 1;
+
+	sweep_stop[index] = *color;
+	sweep_count = count;
+	sweepRestart();
+}
+
+void sweepConfig(unsigned char divider, unsigned char easing)
+{
+	sweep_divider = divider ? divider : 1;
+	sweep_easing = easing;
+	sweepRestart();
+}
+
+unsigned char sweepStops(rgb_color* stops)
+{
+	unsigned char i;
+
+	for(i=0;i<sweep_count;i++)
+		stops[i] = sweep_stop[i];
+	return sweep_count;
+}
+
+unsigned char sweepStep(rgb_color* color)
+{
+	unsigned char result = 0;
+	unsigned char* from;
+	unsigned char t;
+
+	if (sweep_left == 0)
+	{
+		// next leg, turning around at either end
+		sweep_from = sweep_to;
+		if (sweep_from == 0)
+		{
+			sweep_dir = 1;
+			result |= SWEEP_RESTART;
+		}
+		else if (sweep_from >= sweep_count - 1)
+			sweep_dir = -1;
+		sweep_to = (sweep_count > 1) ? sweep_from + sweep_dir : 0;
+		if (sweep_first)
+			result |= SWEEP_CHANGED;
+		sweep_first = 0;
+		sweepLeg();
+	}
+	sweep_left--;
+
+	if (sweep_left == 0)
+		*color = sweep_stop[sweep_to];			// land on the stop exactly
+	else if (sweep_easing == SWEEP_LINEAR)
+	{
+		sweep_acc[0] += sweep_inc[0];
+		sweep_acc[1] += sweep_inc[1];
+		sweep_acc[2] += sweep_inc[2];
+		color->red = sweep_acc[0] >> 8;
+		color->green = sweep_acc[1] >> 8;
+		color->blue = sweep_acc[2] >> 8;
+	}
+	else
+	{
+		sweep_phase += sweep_dphase;
+		t = sweepEase(sweep_phase >> 8) >> 1;
+		from = &sweep_stop[sweep_from].red;
+		color->red = from[0] + ((sweep_diff[0] * t) >> 7);
+		color->green = from[1] + ((sweep_diff[1] * t) >> 7);
+		color->blue = from[2] + ((sweep_diff[2] * t) >> 7);
+	}
+
+	if ((color->red != sweep_last.red) || (color->green != sweep_last.green) || (color->blue != sweep_last.blue))
+		result |= SWEEP_CHANGED;
+	sweep_last = *color;
+
+	return result;
+}
@@ -0,0 +1,58 @@
+//*****************************************************************************
+// File Name	: sweep.h
+// Title		: Color sweep
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Sweeps through a list of color stops and back, 0, 1 .. n-1 .. 1, 0, one
+// step per call of sweepStep(). A leg between two stops takes as many steps
+// as the largest channel difference divided by the divider.
+//
+// The work per leg is done when it starts. Linear legs keep each channel as
+// an 8.8 fixed point value and only add per step. Eased legs add to an 8.8
+// phase, map it through the easing curve and scale the channel differences,
+// one 8 bit multiply per channel.
+//*****************************************************************************
+
+#ifndef sweep_h
+#define sweep_h
+
+//----- Include Files ---------------------------------------------------------
+#include "sweepconf.h"
+#include "ledstrip.h"
+
+//----- Defines ---------------------------------------------------------------
+// easing curves
+#define SWEEP_LINEAR				0
+#define SWEEP_EASE_IN				1			// starts slow
+#define SWEEP_EASE_OUT				2			// ends slow
+#define SWEEP_EASE_IN_OUT			3			// smoothstep, slow at both stops
+
+// sweepStops()
+//     copies the stops in use into stops, SWEEP_STOPS at most
+//     returns their count
+unsigned char sweepStops(rgb_color* stops);
+
+// sweepStep() results, or-ed together
+#define SWEEP_CHANGED				0x01		// the color differs from the last step
+#define SWEEP_RESTART				0x02		// back at the first stop
+
+//----- Functions ---------------------------------------------------------------
+
+// sweepStop()
+//     sets color stop index and cuts the sweep to count stops
+//     restarts the sweep at the first stop
+void sweepStop(unsigned char index, unsigned char count, rgb_color* color);
+
+// sweepConfig()
+//     sets the divider (1 or more) and the easing curve
+//     restarts the sweep at the first stop
+void sweepConfig(unsigned char divider, unsigned char easing);
+
+// sweepStep()
+//     advances one step and stores the color in *color
+//     returns SWEEP_CHANGED if it is not the color of the last step,
+//     plus SWEEP_RESTART when a new round starts
+unsigned char sweepStep(rgb_color* color);
+
+#endif
@@ -0,0 +1,15 @@
+//*****************************************************************************
+// File Name	: sweepconf.h
+// Title		: Color sweep configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef SWEEPCONF_H
+#define SWEEPCONF_H
+
+// Most color stops in a sweep
+#define SWEEP_STOPS					6
+
+#endif
@@ -0,0 +1,97 @@
+//*****************************************************************************
+// File Name	: systime.c
+// Title		: Free-running cycle clock on Timer1
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include "systime.h"
+
+//----- Defines ---------------------------------------------------------------
+// ATmega48/88/168 have one mask and flag register per timer
+#ifdef TIMSK1
+#define SYSTIME_TIMSK				TIMSK1
+#define SYSTIME_TIFR				TIFR1
+#else
+#define SYSTIME_TIMSK				TIMSK
+#define SYSTIME_TIFR				TIFR
+#endif
+
+//----- Global Variables -------------------------------------------------------
+static volatile unsigned short systime_ovf = 0;	// upper 16 bits of the cycle clock
+static unsigned long systime_frac = 0;				// cycles not yet counted in systime_sec
+static volatile unsigned long systime_sec = 0;		// whole seconds
+
+//----- Functions --------------------------------------------------------------
+
+ISR(TIMER1_OVF_vect)
+{
+	systime_ovf++;
+	systime_frac += 0x10000;
+	if (systime_frac >= F_CPU)
+	{
+		systime_frac -= F_CPU;
+		systime_sec++;
+	}
+}
+
+void systimeInit(void)
+{
+	TCCR1A = 0;
+	TCNT1 = 0;
+	TCCR1B = (1 << CS10);			// normal mode, clk/1
+	SYSTIME_TIMSK |= (1 << TOIE1);
+}
+
+unsigned long systimeCycles(void)
+{
+	unsigned char sreg = SREG;
+	unsigned short low;
+	unsigned short high;
+
+	cli();
+	low = TCNT1;
+	high = systime_ovf;
+	// an overflow may be pending if interrupts were disabled
+	// or the counter wrapped between the two reads above
+	if ((SYSTIME_TIFR & (1 << TOV1)) && (low < 0x8000))
+		high++;
+	SREG = sreg;
+
+	return ((unsigned long)high << 16) | low;
+}
+
+unsigned short systimeMs(void)
+{
+	unsigned char sreg = SREG;
+	unsigned long sec;
+	unsigned long cycles;			// cycles into that second
+
+	cli();
+	cycles = TCNT1;
+	if ((SYSTIME_TIFR & (1 << TOV1)) && (cycles < 0x8000))
+		cycles += 0x10000;
+	cycles += systime_frac;
+	sec = systime_sec;
+	SREG = sreg;
+
+	// built from the seconds rather than the cycle clock, which would
+	// step back when it wraps; F_CPU / 8 keeps the product in 32 bits
+	return sec * 1000 + cycles * 125 / (F_CPU / 8);
+}
+
+unsigned long systimeSeconds(void)
+{
+	unsigned char sreg = SREG;
+	unsigned long sec;
+
+	cli();
+	sec = systime_sec;
+	SREG = sreg;
+
+	return sec;
+}
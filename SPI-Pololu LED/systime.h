@@ -0,0 +1,41 @@
+//*****************************************************************************
+// File Name	: systime.h
+// Title		: Free-running cycle clock on Timer1
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Timer1 runs at F_CPU with no prescaler, the overflow interrupt extends it
+// to 32 bits. At 8 MHz the counter wraps after about 536 seconds.
+//*****************************************************************************
+
+#ifndef systime_h
+#define systime_h
+
+//----- Defines ---------------------------------------------------------------
+#define SYSTIME_CYCLES_PER_MS		(F_CPU/1000)
+
+//----- Functions ---------------------------------------------------------------
+
+// systimeInit()
+//     starts Timer1 and enables its overflow interrupt
+//     global interrupts must be enabled by the caller
+void systimeInit(void);
+
+// systimeCycles()
+//     returns the number of cpu cycles since systimeInit()
+//     safe to call with interrupts disabled, as long as they have not
+//     been disabled for longer than one overflow period (65536 cycles)
+unsigned long systimeCycles(void);
+
+// systimeMs()
+//     returns the number of milliseconds since systimeInit(), wraps after 65 s
+//     but keeps counting across the wrap of the cycle clock, so differences
+//     of two readings are right for up to 65 s
+unsigned short systimeMs(void);
+
+// systimeSeconds()
+//     returns the number of seconds since systimeInit(), does not wrap
+//     with the cycle clock
+unsigned long systimeSeconds(void);
+
+#endif
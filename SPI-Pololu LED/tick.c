@@ -0,0 +1,130 @@
+//*****************************************************************************
+// File Name	: tick.c
+// Title		: Timer2 tick and status LEDs
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+//----- Include Files ---------------------------------------------------------
+#include <avr/io.h>				// include I/O definitions (port names, pin names, etc)
+#include <avr/interrupt.h>		// include interrupt support
+#include "tick.h"
+
+//----- Defines ---------------------------------------------------------------
+// clk/64 if the compare value fits in 8 bits, clk/128 otherwise
+#if F_CPU / 64 / TICK_HZ <= 256
+#define TICK_OCR					(F_CPU / 64 / TICK_HZ - 1)
+#define TICK_CS						((1 << CS22))
+#else
+#define TICK_OCR					(F_CPU / 128 / TICK_HZ - 1)
+#define TICK_CS						((1 << CS22) | (1 << CS20))
+#endif
+
+// ATmega48/88/168 have two compare units per timer and a mask register each
+#ifdef TCCR2A
+#define TICK_vect					TIMER2_COMPA_vect
+#else
+#define TICK_vect					TIMER2_COMP_vect
+#endif
+
+//----- Global Variables -------------------------------------------------------
+static volatile unsigned short tick_now = 0;
+static const unsigned char tick_led_pin[TICK_LEDS] = TICK_LED_PINS;
+static volatile unsigned short tick_led_left[TICK_LEDS];	// ticks until the LED toggles, 0 stopped
+static unsigned short tick_led_on[TICK_LEDS];
+static unsigned short tick_led_off[TICK_LEDS];
+
+//----- Functions --------------------------------------------------------------
+
+ISR(TICK_vect)
+{
+	unsigned char i;
+	unsigned char mask;
+
+	tick_now++;
+
+	for(i=0;i<TICK_LEDS;i++)
+	{
+		if (tick_led_left[i] == 0 || --tick_led_left[i])
+			continue;
+
+		mask = 1 << tick_led_pin[i];
+		if (TICK_LED_PORT & mask)
+		{
+			// dark, start the next blink
+			TICK_LED_PORT &= ~mask;
+			tick_led_left[i] = tick_led_on[i];
+		}
+		else
+		{
+			TICK_LED_PORT |= mask;
+			tick_led_left[i] = tick_led_off[i];
+		}
+	}
+}
+
+void tickInit(void)
+{
+	unsigned char i;
+
+	for(i=0;i<TICK_LEDS;i++)
+		TICK_LED_PORT |= (1 << tick_led_pin[i]);
+
+#ifdef TCCR2A
+	TCCR2A = (1 << WGM21);			// CTC
+	TCCR2B = TICK_CS;
+	OCR2A = TICK_OCR;
+	TIMSK2 |= (1 << OCIE2A);
+#else
+	OCR2 = TICK_OCR;
+	TCCR2 = (1 << WGM21) | TICK_CS;	// CTC
+	TIMSK |= (1 << OCIE2);
+#endif
+}
+
+unsigned short tickNow(void)
+{
+	unsigned char sreg = SREG;
+	unsigned short now;
+
+	cli();
+	now = tick_now;
+	SREG = sreg;
+
+	return now;
+}
+
+unsigned char tickDue(unsigned short* deadline, unsigned short period)
+{
+	unsigned short now = tickNow();
+
+	if ((short)(now - *deadline) < 0)
+		return 0;
+
+	*deadline += period;
+	if ((short)(now - *deadline) >= 0)
+		*deadline = now + period;
+	return 1;
+}
+
+void tickLed(unsigned char led, unsigned short on, unsigned short off)
+{
+	unsigned char sreg = SREG;
+	unsigned char mask = 1 << tick_led_pin[led];
+
+	cli();
+	if (on == 0)
+	{
+		TICK_LED_PORT |= mask;
+		tick_led_left[led] = 0;
+	}
+	else if (off == 0 || tick_led_left[led] == 0 || on != tick_led_on[led] || off != tick_led_off[led])
+	{
+		TICK_LED_PORT &= ~mask;
+		tick_led_on[led] = on;
+		tick_led_off[led] = off;
+		tick_led_left[led] = on;
+	}
+	SREG = sreg;
+}
@@ -0,0 +1,45 @@
+//*****************************************************************************
+// File Name	: tick.h
+// Title		: Timer2 tick and status LEDs
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+// Timer2 interrupts TICK_HZ times a second. The tick count paces the frames
+// through tickDue() deadlines, so frame timing does not depend on the work
+// done per frame, and the tick interrupt times the status LED pulses and
+// blinks, so the main loop never waits for them.
+//*****************************************************************************
+
+#ifndef tick_h
+#define tick_h
+
+//----- Include Files ---------------------------------------------------------
+#include "tickconf.h"
+
+//----- Defines ---------------------------------------------------------------
+#define TICK_MS(ms)					((unsigned short)((unsigned long)(ms) * TICK_HZ / 1000))
+
+//----- Functions ---------------------------------------------------------------
+
+// tickInit()
+//     starts Timer2, turns the status LEDs off
+//     global interrupts must be enabled by the caller
+void tickInit(void);
+
+// tickNow()
+//     returns the number of ticks since tickInit(), wraps after 65536
+unsigned short tickNow(void);
+
+// tickDue()
+//     returns 1 once the tick count has reached *deadline and moves the
+//     deadline on by period. A caller that fell more than a period behind
+//     skips the missed frames instead of running them back to back.
+unsigned char tickDue(unsigned short* deadline, unsigned short period);
+
+// tickLed()
+//     lights a status LED for on ticks, then keeps it dark for off ticks and
+//     repeats; off 0 gives one pulse, on 0 turns it off. Calling it again with
+//     the same blink keeps the blink running, a pulse is restarted.
+void tickLed(unsigned char led, unsigned short on, unsigned short off);
+
+#endif
@@ -0,0 +1,22 @@
+//*****************************************************************************
+// File Name	: tickconf.h
+// Title		: Timer2 tick and status LED configuration
+// Target MCU	: Atmel AVR series
+// Editor Tabs	: 4
+//
+//*****************************************************************************
+
+#ifndef TICKCONF_H
+#define TICKCONF_H
+
+// Ticks per second
+#define TICK_HZ						1000
+
+// Status LEDs on port B, lit when the pin is low
+#define TICK_LED_PORT				PORTB
+#define TICK_LED_HEARTBEAT			0			// slot of the heartbeat LED
+#define TICK_LED_ACTIVITY			1			// slot of the activity LED
+#define TICK_LEDS					2
+#define TICK_LED_PINS				{ 6, 0 }	// pin of each slot
+
+#endif